@@ -12,6 +12,12 @@
 extern "C" {
 #endif
 
+/**
+ * \brief Opaque handles to a report and to one of its populations. They remain valid until
+ * sonata_clear() is called, or until sonata_setup_communicators() for reports without nodes.
+ */
+typedef struct sonata_report_t* sonata_report_handle_t;
+typedef struct sonata_population_t* sonata_population_handle_t;
 
 /*! \brief Create a new report
  * @param report_name name of the report to be created
@@ -52,6 +58,115 @@ int sonata_add_element(const char* report_name,
                        uint64_t node_id,
                        uint32_t element_id,
                        double* element_value);
+
+/**
+ * \brief Add several nodes to an existing report at once, avoiding the per-node lookups of
+ * sonata_add_node. Ids given in increasing order are the cheapest to insert.
+ * \return 0 if operator succeeded, -2 if the report doesn't exist, -1 if a node_id already
+ * exists (the nodes before it are added).
+ */
+int sonata_add_nodes(const char* report_name,
+                     const char* population_name,
+                     uint64_t population_offset,
+                     const uint64_t* node_ids,
+                     uint64_t num_nodes);
+
+/**
+ * \brief Add the elements of several existing nodes at once. The elements of node_ids[i] are the
+ * entries [offsets[i], offsets[i + 1]) of element_ids and element_values, as in a CSR layout.
+ * \param offsets array of num_nodes + 1 entries
+ * \return 0 if operator succeeded, -2 if the report doesn't exist, -3 if one of the nodes
+ * doesn't exist, -1 for other errors.
+ */
+int sonata_add_elements_bulk(const char* report_name,
+                             const char* population_name,
+                             const uint64_t* node_ids,
+                             uint64_t num_nodes,
+                             const uint64_t* offsets,
+                             const uint32_t* element_ids,
+                             double* const* element_values);
+
+/**
+ * \brief Get a handle to an existing report, so that the per-step calls skip the name lookups
+ * \return the handle, or NULL if the report doesn't exist
+ */
+sonata_report_handle_t sonata_get_report_handle(const char* report_name);
+
+/**
+ * \brief Get a handle to a population of a report, once at least one node was added to it
+ * \return the handle, or NULL if the report handle is NULL or the population doesn't exist
+ */
+sonata_population_handle_t sonata_get_population_handle(sonata_report_handle_t report,
+                                                        const char* population_name);
+
+/**
+ * \brief Same as sonata_add_node on a report handle
+ * \return 0 if operator succeeded, -2 if the report handle is NULL, -1 if the node_id already
+ * exists.
+ */
+int sonata_report_add_node(sonata_report_handle_t report,
+                           const char* population_name,
+                           uint64_t population_offset,
+                           uint64_t node_id);
+
+/**
+ * \brief Same as sonata_add_element on a population handle
+ * \return 0 if operator succeeded, -2 if the population handle is NULL, -3 if the specified node
+ * doesn't exist, -1 for other errors.
+ */
+int sonata_population_add_element(sonata_population_handle_t population,
+                                  uint64_t node_id,
+                                  uint32_t element_id,
+                                  double* element_value);
+
+/**
+ * \brief Add an element value to an existing node of a summation report, multiplied by weight in
+ * the sums. The other elements have a weight of 1.
+ * \return 0 if operator succeeded, -2 if the report doesn't exist, -3 if the specified node
+ * doesn't exist, -1 for other errors.
+ */
+int sonata_add_weighted_element(const char* report_name,
+                                const char* population_name,
+                                uint64_t node_id,
+                                uint32_t element_id,
+                                double* element_value,
+                                double weight);
+
+/**
+ * \brief Same as sonata_add_weighted_element on a population handle
+ * \return 0 if operator succeeded, -2 if the population handle is NULL, -3 if the specified node
+ * doesn't exist, -1 for other errors.
+ */
+int sonata_population_add_weighted_element(sonata_population_handle_t population,
+                                           uint64_t node_id,
+                                           uint32_t element_id,
+                                           double* element_value,
+                                           double weight);
+
+/**
+ * \brief Add elements to an existing node as positions of a simulator array, instead of one
+ * pointer per element. Moving the array later only requires a call to sonata_rebase_array.
+ * \param base start of the array holding the element values
+ * \param indices position of each element in the array
+ * \param element_ids identifier of each element
+ * \param num_elements number of entries of indices and element_ids
+ * \return 0 if operator succeeded, -2 if the report doesn't exist, -3 if the specified node
+ * doesn't exist, -1 for other errors.
+ */
+int sonata_add_elements_indexed(const char* report_name,
+                                const char* population_name,
+                                uint64_t node_id,
+                                const double* base,
+                                const uint32_t* indices,
+                                const uint32_t* element_ids,
+                                uint32_t num_elements);
+
+/**
+ * \brief Update all the elements registered against the array at old_base after the simulator
+ * moved it to new_base
+ * \return 0 if operator succeeded, -1 if no array was registered at old_base
+ */
+int sonata_rebase_array(const double* old_base, const double* new_base);
 /**
  * \brief Setup buffers and create datasets
  * \return 0
@@ -113,6 +228,15 @@ int sonata_record_node_data(double step,
                             const int* nodeids,
                             const char* report_name);
 
+/**
+ * \brief Save data of node_ids[] to the buffer of a report, without any allocation
+ * \return -1 if the report handle is NULL, 0 otherwise
+ */
+int sonata_report_record_node_data(sonata_report_handle_t report,
+                                   double step,
+                                   const int* node_ids,
+                                   int num_nodes);
+
 /**
  * \brief Save data of all the nodes to buffer
  * \return -3 if the Sonata report doesn't exist, 0 otherwise
@@ -136,6 +260,21 @@ int sonata_get_num_reports();
  */
 int sonata_flush(double time);
 
+/**
+ * \brief Start flushing the buffers to file in the background, so that the simulation can
+ * exchange spikes or integrate the next step before calling sonata_flush_end with the same time.
+ * The steps recorded meanwhile go to the next write. Falls back to writing before returning if
+ * MPI does not provide MPI_THREAD_MULTIPLE.
+ * \return -3 if there was nothing to flush, 0 otherwise
+ */
+int sonata_flush_begin(double time);
+
+/**
+ * \brief Wait for the writes started by sonata_flush_begin and close the files as sonata_flush
+ * \return -3 if there was nothing to flush, 0 otherwise
+ */
+int sonata_flush_end(double time);
+
 /**
  * \brief Update the element values according to the function provided as argument
  */
@@ -156,6 +295,116 @@ int sonata_set_max_buffer_size_hint(size_t buffer_size);
  */
 int sonata_set_report_max_buffer_size_hint(const char* report_name, size_t buffer_size);
 
+/**
+ * \brief Set the order in which the nodes of a report are laid out on each rank. Must be called
+ * before sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param node_order "by_id" (default) or "by_address" to follow the memory address of the first
+ * element of each node, so that recording walks the simulator memory monotonically
+ * @return -1 if the Sonata report doesn't exist, -2 if the order is unknown, 0 otherwise
+ */
+int sonata_set_report_node_order(const char* report_name, const char* node_order);
+
+/**
+ * \brief Set the value recorded for each element at every reporting step of a report. Instead of
+ * the value at that step, the mean, min or max of the values over the steps of the reporting
+ * period ending at that step can be recorded, the steps in between being accumulated by
+ * sonata_record_data and sonata_record_node_data. Those must then be called at every step of the
+ * simulation. The sampling is stored in the "sampling" attribute of the data. Must be called
+ * before sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param sampling "instantaneous" (default), "mean", "min" or "max"
+ * @return -1 if the Sonata report doesn't exist, -2 if the sampling is unknown, 0 otherwise
+ */
+int sonata_set_report_sampling(const char* report_name, const char* sampling);
+
+/**
+ * \brief Set the values summed by a report created with the kind "summation". Each node gets a
+ * column per element id, the weighted sum of its elements with that id, or a single column, the
+ * weighted sum of all its elements, reported with the element id 0. Must be called before
+ * sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param summation "element" (default) or "node"
+ * @return -1 if the Sonata report doesn't exist, -2 if the summation is unknown or the report is
+ * not a summation report, 0 otherwise
+ */
+int sonata_set_report_summation(const char* report_name, const char* summation);
+
+/**
+ * \brief Keep the count, min, max, mean and variance of the values recorded for each element of
+ * a report over the whole simulation, once sampled and summed. They are written at close as the
+ * 1D datasets count, min, max, mean and variance of /report/<population>/statistics, in the order
+ * of the mapping, NaN for the elements never recorded. The data itself can be left out. Must be
+ * called before sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param statistics "none" (default), "with_data" or "without_data"
+ * @return -1 if the Sonata report doesn't exist, -2 if the statistics mode is unknown, 0
+ * otherwise
+ */
+int sonata_set_report_statistics(const char* report_name, const char* statistics);
+
+/**
+ * \brief Set the chunks and compression of the data of a report. Must be called before
+ * sonata_prepare_datasets. The data is written contiguously, as by default, with a level and both
+ * chunk sizes of 0. With MPI, compression requires HDF5 1.10.2 or newer.
+ * @param report_name name of the report
+ * @param level deflate level from 1 to 9, the bytes of the values being shuffled first, 0 for none
+ * @param chunk_steps steps of a chunk, 0 for the steps buffered between two writes
+ * @param chunk_elements elements of a chunk, 0 for the elements of the rank with the most of them,
+ * up to 4 MB per chunk
+ * @return -1 if the Sonata report doesn't exist, -2 if the level is not between 0 and 9, 0
+ * otherwise
+ */
+int sonata_set_report_compression(const char* report_name,
+                                  int level,
+                                  uint32_t chunk_steps,
+                                  uint32_t chunk_elements);
+
+/**
+ * \brief Compress the chunks of a compressed report on the compression threads of the library and
+ * write them with H5Dwrite_chunk, instead of the single-threaded HDF5 filters. The file is the
+ * same, readable by any HDF5 reader. Only in serial builds with zlib and HDF5 1.10.3 or newer,
+ * and for the writes covering whole chunks, the other ones going through the HDF5 filters. Must be
+ * called before sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param enabled 0 to go through the HDF5 filters, as by default
+ * @return -1 if the Sonata report doesn't exist, 0 otherwise
+ */
+int sonata_set_report_direct_chunk_write(const char* report_name, int enabled);
+
+/**
+ * \brief Store the data of a report as 16 or 8 bit integers instead of floats, quantized while
+ * being recorded. The values are decoded as stored * scale_factor + add_offset, both being
+ * attributes of the data. The range is symmetric around the offset, +/- 32767 steps of
+ * scale_factor with 16 bits and +/- 127 with 8 bits, and the values out of it are clamped to it.
+ * The lowest integer is reserved for NaN and written as the _FillValue attribute of the data, so
+ * that the readers following the CF conventions mask it. Must be called before
+ * sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param bits 16 or 8, 0 to store 32 bit floats as by default
+ * @param max_error largest absolute difference between a value and its decoded value, half of
+ * scale_factor
+ * @param offset value stored as 0, the middle of the range of the values. The range is
+ * offset +/- 65534 * max_error with 16 bits, offset +/- 254 * max_error with 8 bits.
+ * @return -1 if the Sonata report doesn't exist, -2 if bits is not supported or max_error is not
+ * positive, 0 otherwise
+ */
+int sonata_set_report_quantization(const char* report_name,
+                                   int bits,
+                                   double max_error,
+                                   double offset);
+
+/**
+ * \brief Store the data of a report as IEEE floats of the given precision, instead of the single
+ * precision floats stored by default. Half precision values have 11 significant bits and range up
+ * to 65504, larger values being stored as infinite. Replaces any quantization of the report. Must
+ * be called before sonata_prepare_datasets.
+ * @param report_name name of the report
+ * @param bits 64, 32 or 16
+ * @return -1 if the Sonata report doesn't exist, -2 if bits is not supported, 0 otherwise
+ */
+int sonata_set_report_precision(const char* report_name, int bits);
+
 /*! \brief Clear all the reports
  * \return 0
  */
@@ -166,6 +415,35 @@ int sonata_clear();
  */
 void sonata_set_atomic_step(double step);
 
+/**
+ * \brief Set the number of threads recording each population on this rank, including the calling
+ * thread. Defaults to the LIBSONATA_NUM_THREADS environment variable, or 1. Populations too small
+ * to benefit from it are always recorded by the calling thread. Best called before
+ * sonata_prepare_datasets, so that the buffers are first touched by the threads recording them.
+ * \return 0 if operator succeeded, -1 if num_threads is lower than 1
+ */
+int sonata_set_num_threads(int num_threads);
+
+/**
+ * \brief Set the number of threads compressing the chunks written directly, see
+ * sonata_set_report_direct_chunk_write, including the thread writing them. Defaults to the
+ * LIBSONATA_NUM_COMPRESSION_THREADS environment variable, or 1.
+ * \return 0 if operator succeeded, -1 if num_threads is lower than 1
+ */
+int sonata_set_num_compression_threads(int num_threads);
+
+/**
+ * \brief Set the number of buffers of each population, each of the size given by
+ * sonata_set_max_buffer_size_hint. With 2 or more, a full buffer is written by a background
+ * thread while the simulation records into the next one, and recording only waits when all the
+ * other buffers are still being written. Defaults to the LIBSONATA_NUM_WRITE_BUFFERS environment
+ * variable, or 1. Ignored if MPI does not provide MPI_THREAD_MULTIPLE. Must be called before
+ * sonata_prepare_datasets. The writes still running are completed by sonata_flush and
+ * sonata_flush_end.
+ * \return 0 if operator succeeded, -1 if num_buffers is lower than 1
+ */
+int sonata_set_num_write_buffers(int num_buffers);
+
 // NOT REQUIRED FOR SONATA
 int sonata_extra_mapping(const char* report_name,
                          uint64_t node_id,
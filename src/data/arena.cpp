@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "arena.h"
+
+namespace bbp {
+namespace sonata {
+
+constexpr size_t Arena::default_block_size;
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size) {}
+
+void* Arena::allocate_bytes(size_t bytes, size_t alignment) {
+    if (bytes == 0) {
+        return nullptr;
+    }
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment;
+    if (cursor_ == nullptr || padding + bytes > remaining_) {
+        // Big arrays get a block of their own, the current block keeps serving small ones
+        const size_t size = std::max(block_size_, bytes + alignment);
+        blocks_.emplace_back(new char[size]);
+        if (size > block_size_ && cursor_ != nullptr) {
+            char* block = blocks_.back().get();
+            padding = (alignment - reinterpret_cast<uintptr_t>(block) % alignment) % alignment;
+            allocated_bytes_ += bytes;
+            return block + padding;
+        }
+        cursor_ = blocks_.back().get();
+        remaining_ = size;
+        padding = (alignment - reinterpret_cast<uintptr_t>(cursor_) % alignment) % alignment;
+    }
+    void* result = cursor_ + padding;
+    cursor_ += padding + bytes;
+    remaining_ -= padding + bytes;
+    allocated_bytes_ += bytes;
+    return result;
+}
+
+void Arena::clear() {
+    blocks_.clear();
+    cursor_ = nullptr;
+    remaining_ = 0;
+    allocated_bytes_ = 0;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Bump allocator for the arrays of a report. Memory is only released all at once, when
+ * the arena is cleared or destroyed, so it only holds trivially destructible types.
+ */
+class Arena
+{
+  public:
+    static constexpr size_t default_block_size = 1 << 20;
+
+    explicit Arena(size_t block_size = default_block_size);
+
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena memory is released without calling destructors");
+        return static_cast<T*>(allocate_bytes(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * \brief Bytes handed out by allocate since the arena was created or cleared
+     */
+    size_t get_allocated_bytes() const noexcept {
+        return allocated_bytes_;
+    }
+
+    void clear();
+
+  private:
+    void* allocate_bytes(size_t bytes, size_t alignment);
+
+    size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* cursor_ = nullptr;
+    size_t remaining_ = 0;
+    size_t allocated_bytes_ = 0;
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,40 @@
+#include "array_registry.h"
+
+namespace bbp {
+namespace sonata {
+
+const double* const* ArrayRegistry::register_array(const double* base) {
+    auto it = cells_.find(base);
+    if (it != cells_.end()) {
+        return &bases_[it->second];
+    }
+    // std::deque keeps the address of existing cells stable when growing
+    bases_.push_back(base);
+    cells_.emplace(base, bases_.size() - 1);
+    return &bases_.back();
+}
+
+size_t ArrayRegistry::rebase_array(const double* old_base, const double* new_base) {
+    size_t updated = 0;
+    for (auto& base : bases_) {
+        if (base == old_base) {
+            base = new_base;
+            ++updated;
+        }
+    }
+    if (updated > 0) {
+        cells_.clear();
+        for (size_t i = 0; i < bases_.size(); ++i) {
+            cells_[bases_[i]] = i;
+        }
+    }
+    return updated;
+}
+
+void ArrayRegistry::clear() {
+    cells_.clear();
+    bases_.clear();
+}
+
+}  // namespace sonata
+}  // namespace bbp
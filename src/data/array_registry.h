@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Keeps one cell per simulator array that elements are registered against by index.
+ * Nodes and gather plans only hold the address of the cell, so moving an array is a single update
+ * of its cell no matter how many elements point into it.
+ */
+class ArrayRegistry
+{
+  public:
+    /**
+     * \brief Return the cell holding base, creating it if the array is not known yet
+     */
+    const double* const* register_array(const double* base);
+
+    /**
+     * \brief Point every array currently registered at old_base to new_base
+     * \return number of arrays that were updated
+     */
+    size_t rebase_array(const double* old_base, const double* new_base);
+
+    void clear();
+
+  private:
+    std::deque<const double*> bases_;
+    std::unordered_map<const double*, size_t> cells_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
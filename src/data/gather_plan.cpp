@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SONATA_REPORT_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "gather_plan.h"
+
+namespace bbp {
+namespace sonata {
+
+namespace {
+
+// Runs of at least this many consecutive addresses are converted without gathers
+constexpr size_t min_contiguous_run = 8;
+// Doubles gathered before being quantized, 2 KB
+constexpr size_t quantization_block = 256;
+
+using gather_convert_t = void (*)(const double* const*, size_t, float*);
+using gather_convert_indexed_t = void (*)(const double*, const uint32_t*, size_t, float*);
+using convert_t = void (*)(const double*, size_t, float*);
+using gather_t = void (*)(const double* const*, size_t, double*);
+using gather_indexed_t = void (*)(const double*, const uint32_t*, size_t, double*);
+using quantize_int16_t = void (*)(const double*, size_t, double, double, int16_t*);
+using quantize_int8_t = void (*)(const double*, size_t, double, double, int8_t*);
+using convert_float16_t = void (*)(const double*, size_t, float16*);
+
+void gather_convert_scalar(const double* const* sources, size_t count, float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(*sources[i]);
+    }
+}
+
+void gather_convert_indexed_scalar(const double* base,
+                                   const uint32_t* indices,
+                                   size_t count,
+                                   float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(base[indices[i]]);
+    }
+}
+
+void convert_scalar(const double* values, size_t count, float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<float>(values[i]);
+    }
+}
+
+void gather_scalar(const double* const* sources, size_t count, double* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = *sources[i];
+    }
+}
+
+void gather_indexed_scalar(const double* base, const uint32_t* indices, size_t count, double* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = base[indices[i]];
+    }
+}
+
+void convert_float16_scalar(const double* values, size_t count, float16* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = to_float16(static_cast<float>(values[i]));
+    }
+}
+
+// Clamped to [-max, max] as the vector max and min instructions do, the lowest integer being left
+// for NaN, and rounded to the nearest even integer as the vector conversions do
+template <typename T>
+void quantize_scalar(const double* values, size_t count, double scale, double offset, T* out) {
+    const double inverse_scale = 1.0 / scale;
+    const double highest = std::numeric_limits<T>::max();
+    for (size_t i = 0; i < count; ++i) {
+        double value = (values[i] - offset) * inverse_scale;
+        if (std::isnan(value)) {
+            out[i] = std::numeric_limits<T>::lowest();
+            continue;
+        }
+        value = value > -highest ? value : -highest;
+        value = value < highest ? value : highest;
+        out[i] = static_cast<T>(std::nearbyint(value));
+    }
+}
+
+#ifdef SONATA_REPORT_X86_DISPATCH
+// The pointers themselves are used as 64-bit gather indices on a null base address
+__attribute__((target("avx2"))) void gather_convert_avx2(const double* const* sources,
+                                                         size_t count,
+                                                         float* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i addresses = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sources + i));
+        const __m256d values = _mm256_i64gather_pd(static_cast<const double*>(nullptr),
+                                                   addresses,
+                                                   1);
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(values));
+    }
+    gather_convert_scalar(sources + i, count - i, out + i);
+}
+
+// Indices are zero-extended to 64 bits so that the whole uint32_t range is valid
+__attribute__((target("avx2"))) void gather_convert_indexed_avx2(const double* base,
+                                                                 const uint32_t* indices,
+                                                                 size_t count,
+                                                                 float* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        const __m256d values = _mm256_i64gather_pd(base, _mm256_cvtepu32_epi64(index), 8);
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(values));
+    }
+    gather_convert_indexed_scalar(base, indices + i, count - i, out + i);
+}
+
+__attribute__((target("avx2"))) void convert_avx2(const double* values,
+                                                  size_t count,
+                                                  float* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(values + i)));
+    }
+    convert_scalar(values + i, count - i, out + i);
+}
+
+__attribute__((target("avx2"))) void gather_avx2(const double* const* sources,
+                                                 size_t count,
+                                                 double* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i addresses = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sources + i));
+        _mm256_storeu_pd(out + i,
+                         _mm256_i64gather_pd(static_cast<const double*>(nullptr), addresses, 1));
+    }
+    gather_scalar(sources + i, count - i, out + i);
+}
+
+__attribute__((target("avx2"))) void gather_indexed_avx2(const double* base,
+                                                         const uint32_t* indices,
+                                                         size_t count,
+                                                         double* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        _mm256_storeu_pd(out + i, _mm256_i64gather_pd(base, _mm256_cvtepu32_epi64(index), 8));
+    }
+    gather_indexed_scalar(base, indices + i, count - i, out + i);
+}
+
+// 4 values quantized into 32-bit integers, saturated beforehand so that they fit in T. NaN gives
+// -max from the max instruction, replaced by the lowest integer.
+template <typename T>
+__attribute__((target("avx2"))) __m128i quantize_avx2(const double* values,
+                                                      __m256d inverse_scale,
+                                                      __m256d offset) {
+    const __m256d lowest = _mm256_set1_pd(std::numeric_limits<T>::lowest());
+    const __m256d lower = _mm256_set1_pd(-std::numeric_limits<T>::max());
+    const __m256d highest = _mm256_set1_pd(std::numeric_limits<T>::max());
+    __m256d value = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(values), offset), inverse_scale);
+    const __m256d nan = _mm256_cmp_pd(value, value, _CMP_UNORD_Q);
+    value = _mm256_min_pd(_mm256_max_pd(value, lower), highest);
+    return _mm256_cvtpd_epi32(_mm256_blendv_pd(value, lowest, nan));
+}
+
+__attribute__((target("avx2"))) void quantize_int16_avx2(
+    const double* values, size_t count, double scale, double offset, int16_t* out) {
+    const __m256d inverse_scale = _mm256_set1_pd(1.0 / scale);
+    const __m256d offsets = _mm256_set1_pd(offset);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i integers = quantize_avx2<int16_t>(values + i, inverse_scale, offsets);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(integers, integers));
+    }
+    quantize_scalar(values + i, count - i, scale, offset, out + i);
+}
+
+__attribute__((target("avx2"))) void quantize_int8_avx2(
+    const double* values, size_t count, double scale, double offset, int8_t* out) {
+    const __m256d inverse_scale = _mm256_set1_pd(1.0 / scale);
+    const __m256d offsets = _mm256_set1_pd(offset);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i integers = quantize_avx2<int8_t>(values + i, inverse_scale, offsets);
+        const __m128i shorts = _mm_packs_epi32(integers, integers);
+        const int32_t bytes = _mm_cvtsi128_si32(_mm_packs_epi16(shorts, shorts));
+        std::memcpy(out + i, &bytes, sizeof(bytes));
+    }
+    quantize_scalar(values + i, count - i, scale, offset, out + i);
+}
+
+__attribute__((target("avx2,f16c"))) void convert_float16_avx2(const double* values,
+                                                               size_t count,
+                                                               float16* out) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 floats = _mm256_cvtpd_ps(_mm256_loadu_pd(values + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i),
+                         _mm_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT));
+    }
+    convert_float16_scalar(values + i, count - i, out + i);
+}
+
+// The AVX-512 kernels use the zero-masked forms of the intrinsics, with every lane enabled: the
+// plain ones merge into an undefined register, which GCC reports as maybe uninitialized
+__attribute__((target("avx512f"))) void gather_convert_avx512(const double* const* sources,
+                                                              size_t count,
+                                                              float* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512i addresses = _mm512_loadu_si512(sources + i);
+        const __m512d values =
+            _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, addresses, nullptr, 1);
+        _mm256_storeu_ps(out + i, _mm512_maskz_cvtpd_ps(0xFF, values));
+    }
+    gather_convert_scalar(sources + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f"))) void gather_convert_indexed_avx512(const double* base,
+                                                                      const uint32_t* indices,
+                                                                      size_t count,
+                                                                      float* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        const __m512i positions = _mm512_maskz_cvtepu32_epi64(0xFF, index);
+        const __m512d values =
+            _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, positions, base, 8);
+        _mm256_storeu_ps(out + i, _mm512_maskz_cvtpd_ps(0xFF, values));
+    }
+    gather_convert_indexed_scalar(base, indices + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f"))) void convert_avx512(const double* values,
+                                                       size_t count,
+                                                       float* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm512_maskz_cvtpd_ps(0xFF, _mm512_loadu_pd(values + i)));
+    }
+    convert_scalar(values + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f"))) void gather_avx512(const double* const* sources,
+                                                      size_t count,
+                                                      double* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512i addresses = _mm512_loadu_si512(sources + i);
+        const __m512d values =
+            _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, addresses, nullptr, 1);
+        _mm512_storeu_pd(out + i, values);
+    }
+    gather_scalar(sources + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f"))) void gather_indexed_avx512(const double* base,
+                                                              const uint32_t* indices,
+                                                              size_t count,
+                                                              double* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        const __m512i positions = _mm512_maskz_cvtepu32_epi64(0xFF, index);
+        _mm512_storeu_pd(out + i,
+                         _mm512_mask_i64gather_pd(_mm512_setzero_pd(), 0xFF, positions, base, 8));
+    }
+    gather_indexed_scalar(base, indices + i, count - i, out + i);
+}
+#endif
+
+struct GatherKernels {
+    gather_convert_t gather_convert;
+    gather_convert_indexed_t gather_convert_indexed;
+    convert_t convert;
+    gather_t gather;
+    gather_indexed_t gather_indexed;
+    quantize_int16_t quantize_int16;
+    quantize_int8_t quantize_int8;
+    convert_float16_t convert_float16;
+};
+
+GatherKernels select_kernels() {
+#ifdef SONATA_REPORT_X86_DISPATCH
+    __builtin_cpu_init();
+    // The quantization and the halves only need 4 doubles at a time, the AVX2 versions are used
+    // with AVX-512 too. The halves need F16C, a separate extension.
+    const convert_float16_t convert_float16 =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") ? convert_float16_avx2
+                                                                        : convert_float16_scalar;
+    if (__builtin_cpu_supports("avx512f")) {
+        return {gather_convert_avx512,
+                gather_convert_indexed_avx512,
+                convert_avx512,
+                gather_avx512,
+                gather_indexed_avx512,
+                quantize_int16_avx2,
+                quantize_int8_avx2,
+                convert_float16};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {gather_convert_avx2,
+                gather_convert_indexed_avx2,
+                convert_avx2,
+                gather_avx2,
+                gather_indexed_avx2,
+                quantize_int16_avx2,
+                quantize_int8_avx2,
+                convert_float16};
+    }
+#endif
+    return {gather_convert_scalar,
+            gather_convert_indexed_scalar,
+            convert_scalar,
+            gather_scalar,
+            gather_indexed_scalar,
+            quantize_scalar<int16_t>,
+            quantize_scalar<int8_t>,
+            convert_float16_scalar};
+}
+
+const GatherKernels kernels = select_kernels();
+
+}  // namespace
+
+void gather_convert(const double* const* sources, size_t count, float* out) {
+    kernels.gather_convert(sources, count, out);
+}
+
+void gather_convert(const double* base, const uint32_t* indices, size_t count, float* out) {
+    kernels.gather_convert_indexed(base, indices, count, out);
+}
+
+void convert(const double* values, size_t count, float* out) {
+    kernels.convert(values, count, out);
+}
+
+void gather(const double* const* sources, size_t count, double* out) {
+    kernels.gather(sources, count, out);
+}
+
+void gather(const double* base, const uint32_t* indices, size_t count, double* out) {
+    kernels.gather_indexed(base, indices, count, out);
+}
+
+void convert(const double* values, size_t count, float16* out) {
+    kernels.convert_float16(values, count, out);
+}
+
+void quantize(const double* values, size_t count, double scale, double offset, int16_t* out) {
+    kernels.quantize_int16(values, count, scale, offset, out);
+}
+
+void quantize(const double* values, size_t count, double scale, double offset, int8_t* out) {
+    kernels.quantize_int8(values, count, scale, offset, out);
+}
+
+template <typename T>
+void GatherPlan::append(const double* const* base,
+                        const T* entries,
+                        size_t position,
+                        size_t& run_length) {
+    if (!segments_.empty() && segments_.back().base == base) {
+        Segment& segment = segments_.back();
+        const size_t length = size_ - segment.begin;
+        if (segment.contiguous) {
+            if (entries[position] == entries[segment.offset] + length) {
+                ++size_;
+                return;
+            }
+        } else if (position == segment.offset + length) {
+            run_length = (entries[position] == entries[position - 1] + 1) ? run_length + 1 : 1;
+            ++size_;
+            if (run_length == min_contiguous_run) {
+                // Move the run at the end of the segment to a contiguous segment of its own
+                const size_t run_begin = size_ - min_contiguous_run;
+                if (segment.begin == run_begin) {
+                    segments_.pop_back();
+                }
+                segments_.push_back({run_begin, base, position + 1 - min_contiguous_run, true});
+            }
+            return;
+        }
+    }
+    segments_.push_back({size_, base, position, false});
+    run_length = 1;
+    ++size_;
+}
+
+void GatherPlan::build(const NodeTable& nodes, const std::vector<uint32_t>& order) {
+    segments_.clear();
+    sources_ = nodes.get_pointers();
+    indices_ = nodes.get_indices();
+    node_begins_.clear();
+    node_begins_.reserve(order.size() + 1);
+    size_ = 0;
+    size_t run_length = 0;
+    for (uint32_t node : order) {
+        node_begins_.push_back(size_);
+        const double* const* base = nodes.get_base(node);
+        const size_t begin = nodes.get_source_begin(node);
+        const size_t end = begin + nodes.get_num_elements(node);
+        for (size_t position = begin; position < end; ++position) {
+            if (base == nullptr) {
+                append(base, sources_, position, run_length);
+            } else {
+                append(base, indices_, position, run_length);
+            }
+        }
+    }
+    node_begins_.push_back(size_);
+
+    // Segments are only final once all the runs are detected
+    node_segments_.resize(order.size());
+    size_t segment = 0;
+    for (size_t node = 0; node < order.size(); ++node) {
+        while (segment + 1 < segments_.size() &&
+               segments_[segment + 1].begin <= node_begins_[node]) {
+            ++segment;
+        }
+        node_segments_[node] = segment;
+    }
+}
+
+template <typename T>
+void GatherPlan::gather(size_t begin, size_t end, T* out) const {
+    if (begin >= end) {
+        return;
+    }
+    // Last segment starting at or before begin
+    auto segment = std::upper_bound(segments_.begin(),
+                                     segments_.end(),
+                                     begin,
+                                     [](size_t position, const Segment& s) {
+                                         return position < s.begin;
+                                     }) -
+                   1;
+    gather(segment, begin, end, out);
+}
+
+template <typename T>
+void GatherPlan::gather_node(size_t node, T* out) const {
+    const size_t begin = node_begins_[node];
+    const size_t end = node_begins_[node + 1];
+    if (begin < end) {
+        gather(segments_.begin() + node_segments_[node], begin, end, out);
+    }
+}
+
+template <typename T>
+void GatherPlan::gather(std::vector<Segment>::const_iterator segment,
+                        size_t begin,
+                        size_t end,
+                        T* out) const {
+    while (begin < end) {
+        const size_t segment_end = (segment + 1 == segments_.end()) ? size_ : (segment + 1)->begin;
+        const size_t count = std::min(end, segment_end) - begin;
+        const size_t offset = segment->offset + (begin - segment->begin);
+        if (segment->contiguous) {
+            const double* first = segment->base
+                                      ? *segment->base + indices_[segment->offset]
+                                      : sources_[segment->offset];
+            encode(first + (begin - segment->begin), count, out);
+        } else if (segment->base) {
+            gather_encode(*segment->base, indices_ + offset, count, out);
+        } else {
+            gather_encode(sources_ + offset, count, out);
+        }
+        out += count;
+        begin += count;
+        ++segment;
+    }
+}
+
+template <typename T>
+void GatherPlan::store(const double* values, size_t count, T* out) const {
+    encode(values, count, out);
+}
+
+void GatherPlan::encode(const double* values, size_t count, float* out) const {
+    convert(values, count, out);
+}
+
+void GatherPlan::gather_encode(const double* const* sources, size_t count, float* out) const {
+    gather_convert(sources, count, out);
+}
+
+void GatherPlan::gather_encode(const double* base,
+                               const uint32_t* indices,
+                               size_t count,
+                               float* out) const {
+    gather_convert(base, indices, count, out);
+}
+
+void GatherPlan::encode(const double* values, size_t count, double* out) const {
+    std::memcpy(out, values, count * sizeof(double));
+}
+
+void GatherPlan::gather_encode(const double* const* sources, size_t count, double* out) const {
+    sonata::gather(sources, count, out);
+}
+
+void GatherPlan::gather_encode(const double* base,
+                               const uint32_t* indices,
+                               size_t count,
+                               double* out) const {
+    sonata::gather(base, indices, count, out);
+}
+
+void GatherPlan::encode(const double* values, size_t count, float16* out) const {
+    convert(values, count, out);
+}
+
+template <typename T>
+void GatherPlan::encode(const double* values, size_t count, T* out) const {
+    quantize(values, count, scale_, offset_, out);
+}
+
+template <typename T>
+void GatherPlan::gather_encode(const double* const* sources, size_t count, T* out) const {
+    double block[quantization_block];
+    for (size_t i = 0; i < count; i += quantization_block) {
+        const size_t block_size = std::min(quantization_block, count - i);
+        sonata::gather(sources + i, block_size, block);
+        encode(block, block_size, out + i);
+    }
+}
+
+template <typename T>
+void GatherPlan::gather_encode(const double* base,
+                               const uint32_t* indices,
+                               size_t count,
+                               T* out) const {
+    double block[quantization_block];
+    for (size_t i = 0; i < count; i += quantization_block) {
+        const size_t block_size = std::min(quantization_block, count - i);
+        sonata::gather(base, indices + i, block_size, block);
+        encode(block, block_size, out + i);
+    }
+}
+
+template void GatherPlan::gather<float>(size_t begin, size_t end, float* out) const;
+template void GatherPlan::gather<double>(size_t begin, size_t end, double* out) const;
+template void GatherPlan::gather<float16>(size_t begin, size_t end, float16* out) const;
+template void GatherPlan::gather<int16_t>(size_t begin, size_t end, int16_t* out) const;
+template void GatherPlan::gather<int8_t>(size_t begin, size_t end, int8_t* out) const;
+template void GatherPlan::gather_node<float>(size_t node, float* out) const;
+template void GatherPlan::gather_node<double>(size_t node, double* out) const;
+template void GatherPlan::gather_node<float16>(size_t node, float16* out) const;
+template void GatherPlan::gather_node<int16_t>(size_t node, int16_t* out) const;
+template void GatherPlan::gather_node<int8_t>(size_t node, int8_t* out) const;
+template void GatherPlan::store<float>(const double* values, size_t count, float* out) const;
+template void GatherPlan::store<double>(const double* values, size_t count, double* out) const;
+template void GatherPlan::store<float16>(const double* values, size_t count, float16* out) const;
+template void GatherPlan::store<int16_t>(const double* values, size_t count, int16_t* out) const;
+template void GatherPlan::store<int8_t>(const double* values, size_t count, int8_t* out) const;
+
+}  // namespace sonata
+}  // namespace bbp
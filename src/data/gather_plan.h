@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "node_table.h"
+#include "storage.h"
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Segments of the element sources of a population, in the same order as the elements are
+ * laid out in one step of the report buffer. Built once per population so that recording a step is
+ * a few gather/convert loops instead of a traversal of the node map. Runs of elements that are
+ * consecutive in memory are detected and converted with plain vector loads. Elements are stored
+ * as floats, doubles or halves, or quantized to integers while being gathered.
+ *
+ * The plan reads the pointers and indices from the arrays of the node table, which must outlive
+ * it, instead of keeping a copy of them.
+ */
+class GatherPlan
+{
+  public:
+    /**
+     * \brief Lay out the elements of the nodes of a sealed table, taken in the given order
+     * \param order positions of the nodes in the table
+     */
+    void build(const NodeTable& nodes, const std::vector<uint32_t>& order);
+
+    /**
+     * \brief Quantize the elements gathered into integers as (value - offset) / scale
+     */
+    void set_quantization(double scale, double offset) noexcept {
+        scale_ = scale;
+        offset_ = offset;
+    }
+
+    /**
+     * \brief Convert the elements [begin, end) of a step into out[0, end - begin). T is any type
+     * of visit_storage_type.
+     */
+    template <typename T>
+    void gather(size_t begin, size_t end, T* out) const;
+
+    /**
+     * \brief Convert the elements of the node-th node of the build order into out[0, num_elements)
+     */
+    template <typename T>
+    void gather_node(size_t node, T* out) const;
+
+    /**
+     * \brief Convert count consecutive doubles into out as the elements are when gathered
+     */
+    template <typename T>
+    void store(const double* values, size_t count, T* out) const;
+
+    size_t size() const noexcept {
+        return size_;
+    }
+    size_t get_node_begin(size_t node) const noexcept {
+        return node_begins_[node];
+    }
+    size_t get_num_segments() const noexcept {
+        return segments_.size();
+    }
+
+  private:
+    /**
+     * Consecutive elements read the same way: through sources_ when base is null, or as
+     * (*base)[indices_[i]] otherwise, starting at offset in the array of the node table. Each
+     * segment ends where the next one begins. Contiguous segments only read their first entry,
+     * the next elements follow it in memory.
+     */
+    struct Segment {
+        size_t begin;
+        const double* const* base;
+        size_t offset;
+        bool contiguous;
+    };
+
+    template <typename T>
+    void append(const double* const* base, const T* entries, size_t position, size_t& run_length);
+    template <typename T>
+    void gather(std::vector<Segment>::const_iterator segment, size_t begin, size_t end, T* out)
+        const;
+
+    // Fused gather and conversion into floats, and plain gather of doubles. Halves and integers
+    // are gathered into blocks small enough to stay in the L1 cache, converted right away.
+    void encode(const double* values, size_t count, float* out) const;
+    void gather_encode(const double* const* sources, size_t count, float* out) const;
+    void gather_encode(const double* base, const uint32_t* indices, size_t count, float* out)
+        const;
+    void encode(const double* values, size_t count, double* out) const;
+    void gather_encode(const double* const* sources, size_t count, double* out) const;
+    void gather_encode(const double* base, const uint32_t* indices, size_t count, double* out)
+        const;
+    void encode(const double* values, size_t count, float16* out) const;
+    template <typename T>
+    void encode(const double* values, size_t count, T* out) const;
+    template <typename T>
+    void gather_encode(const double* const* sources, size_t count, T* out) const;
+    template <typename T>
+    void gather_encode(const double* base, const uint32_t* indices, size_t count, T* out) const;
+
+    std::vector<Segment> segments_;
+    // Position of the first element of each node (plus the total) and the segment holding it
+    std::vector<size_t> node_begins_;
+    std::vector<size_t> node_segments_;
+    const double* const* sources_ = nullptr;
+    const uint32_t* indices_ = nullptr;
+    size_t size_ = 0;
+    double scale_ = 1.0;
+    double offset_ = 0.0;
+};
+
+/**
+ * \brief Read count doubles through the sources pointers and store them as floats, using the
+ * widest gather instructions supported by the CPU
+ */
+void gather_convert(const double* const* sources, size_t count, float* out);
+
+/**
+ * \brief Same as gather_convert for the doubles base[indices[0]] ... base[indices[count - 1]]
+ */
+void gather_convert(const double* base, const uint32_t* indices, size_t count, float* out);
+
+/**
+ * \brief Convert count consecutive doubles to floats
+ */
+void convert(const double* values, size_t count, float* out);
+
+/**
+ * \brief Read count doubles through the sources pointers, without converting them
+ */
+void gather(const double* const* sources, size_t count, double* out);
+
+/**
+ * \brief Same as gather for the doubles base[indices[0]] ... base[indices[count - 1]]
+ */
+void gather(const double* base, const uint32_t* indices, size_t count, double* out);
+
+/**
+ * \brief Convert count consecutive doubles to halves, through floats
+ */
+void convert(const double* values, size_t count, float16* out);
+
+/**
+ * \brief Store (values[i] - offset) / scale rounded to the nearest integer, saturated to the
+ * symmetric range [-max, max] of the integer type. NaN values are stored as the lowest integer,
+ * which no other value takes.
+ */
+void quantize(const double* values, size_t count, double scale, double offset, int16_t* out);
+void quantize(const double* values, size_t count, double scale, double offset, int8_t* out);
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "node_table.h"
+
+namespace bbp {
+namespace sonata {
+
+constexpr uint32_t NodeTable::unlimited;
+constexpr size_t NodeTable::npos;
+
+namespace {
+
+constexpr uint32_t no_slot = std::numeric_limits<uint32_t>::max();
+
+size_t hash_node_id(uint64_t node_id) noexcept {
+    return static_cast<size_t>((node_id * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+}  // namespace
+
+NodeTable::NodeTable(uint32_t max_elements_per_node,
+                     std::shared_ptr<Arena> arena,
+                     bool sort_elements)
+    : max_elements_per_node_(max_elements_per_node)
+    , arena_(std::move(arena))
+    , sort_elements_(sort_elements) {}
+
+void NodeTable::add_node(uint64_t node_id) {
+    add_nodes(&node_id, 1);
+}
+
+void NodeTable::add_nodes(const uint64_t* node_ids, size_t num_nodes) {
+    if (sealed_) {
+        throw std::runtime_error("ERROR: nodes can't be added once the report is prepared");
+    }
+    reserve_pending(num_nodes_ + num_nodes);
+    pending_node_ids_.reserve(pending_node_ids_.size() + num_nodes);
+    pending_counts_.reserve(pending_counts_.size() + num_nodes);
+    pending_bases_.reserve(pending_bases_.size() + num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const uint64_t node_id = node_ids[i];
+        const size_t position = find_pending(node_id);
+        if (pending_lookup_[position] != no_slot) {
+            throw std::runtime_error("Warning: attempted to add node " + std::to_string(node_id) +
+                                     " to the target multiple times on same node. Ignoring.");
+        }
+        pending_lookup_[position] = static_cast<uint32_t>(num_nodes_);
+        pending_node_ids_.push_back(node_id);
+        pending_counts_.push_back(0);
+        pending_bases_.push_back(nullptr);
+        ++num_nodes_;
+    }
+}
+
+size_t NodeTable::find_pending(uint64_t node_id) const noexcept {
+    // Linear probing, the table is kept at most half full
+    const size_t mask = pending_lookup_.size() - 1;
+    size_t position = hash_node_id(node_id) & mask;
+    while (pending_lookup_[position] != no_slot &&
+           pending_node_ids_[pending_lookup_[position]] != node_id) {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+void NodeTable::reserve_pending(size_t num_nodes) {
+    if (2 * num_nodes <= pending_lookup_.size()) {
+        return;
+    }
+    size_t size = std::max<size_t>(pending_lookup_.size(), 16);
+    while (2 * num_nodes > size) {
+        size *= 2;
+    }
+    pending_lookup_.assign(size, no_slot);
+    for (uint32_t slot = 0; slot < pending_node_ids_.size(); ++slot) {
+        pending_lookup_[find_pending(pending_node_ids_[slot])] = slot;
+    }
+}
+
+uint32_t NodeTable::get_pending_slot(uint64_t node_id) const {
+    if (sealed_) {
+        throw std::runtime_error("ERROR: elements can't be added once the report is prepared");
+    }
+    const uint32_t slot = pending_lookup_.empty() ? no_slot
+                                                  : pending_lookup_[find_pending(node_id)];
+    if (slot == no_slot) {
+        throw std::out_of_range("ERROR: node " + std::to_string(node_id) + " doesn't exist");
+    }
+    return slot;
+}
+
+void NodeTable::check_capacity(uint32_t slot, size_t num_elements) const {
+    if (pending_counts_[slot] + num_elements > max_elements_per_node_) {
+        throw std::runtime_error("ERROR: node " + std::to_string(pending_node_ids_[slot]) +
+                                 " can only have " + std::to_string(max_elements_per_node_) +
+                                 " element(s)");
+    }
+}
+
+void NodeTable::add_element(uint64_t node_id, double* element_value, uint32_t element_id) {
+    add_elements(node_id, &element_value, &element_id, 1);
+}
+
+void NodeTable::add_weighted_element(uint64_t node_id,
+                                     double* element_value,
+                                     uint32_t element_id,
+                                     double weight) {
+    add_elements(node_id, &element_value, &element_id, 1);
+    pending_weights_.resize(pending_element_ids_.size(), 1.0);
+    pending_weights_.back() = weight;
+}
+
+void NodeTable::add_elements(uint64_t node_id,
+                             double* const* element_values,
+                             const uint32_t* element_ids,
+                             size_t num_elements) {
+    const uint32_t slot = get_pending_slot(node_id);
+    if (pending_bases_[slot] != nullptr) {
+        throw std::runtime_error("ERROR: node " + std::to_string(node_id) +
+                                 " has indexed elements, pointers can't be added to it");
+    }
+    check_capacity(slot, num_elements);
+    pending_element_nodes_.insert(pending_element_nodes_.end(), num_elements, slot);
+    pending_pointers_.insert(
+        pending_pointers_.end(), element_values, element_values + num_elements);
+    pending_element_ids_.insert(
+        pending_element_ids_.end(), element_ids, element_ids + num_elements);
+    pending_counts_[slot] += num_elements;
+    num_elements_ += num_elements;
+}
+
+void NodeTable::add_elements(const uint64_t* node_ids,
+                             size_t num_nodes,
+                             const uint64_t* offsets,
+                             const uint32_t* element_ids,
+                             double* const* element_values) {
+    const size_t num_elements = num_nodes > 0 ? offsets[num_nodes] - offsets[0] : 0;
+    pending_element_nodes_.reserve(pending_element_nodes_.size() + num_elements);
+    pending_pointers_.reserve(pending_pointers_.size() + num_elements);
+    pending_element_ids_.reserve(pending_element_ids_.size() + num_elements);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        add_elements(node_ids[i],
+                     element_values + offsets[i],
+                     element_ids + offsets[i],
+                     offsets[i + 1] - offsets[i]);
+    }
+}
+
+void NodeTable::add_indexed_elements(uint64_t node_id,
+                                     const double* const* base,
+                                     const uint32_t* indices,
+                                     const uint32_t* element_ids,
+                                     size_t num_elements) {
+    const uint32_t slot = get_pending_slot(node_id);
+    const double* const* node_base = pending_bases_[slot];
+    if ((node_base == nullptr && pending_counts_[slot] > 0) ||
+        (node_base != nullptr && node_base != base)) {
+        throw std::runtime_error("ERROR: all the elements of node " + std::to_string(node_id) +
+                                 " must be registered against the same array");
+    }
+    check_capacity(slot, num_elements);
+    pending_bases_[slot] = base;
+    pending_element_nodes_.insert(pending_element_nodes_.end(), num_elements, slot);
+    pending_indices_.insert(pending_indices_.end(), indices, indices + num_elements);
+    pending_element_ids_.insert(
+        pending_element_ids_.end(), element_ids, element_ids + num_elements);
+    pending_counts_[slot] += num_elements;
+    num_elements_ += num_elements;
+}
+
+void NodeTable::refresh_pointers(std::function<double*(double*)> refresh_function) {
+    // Indexed elements follow their array through the ArrayRegistry instead
+    if (!sealed_) {
+        for (double*& pointer : pending_pointers_) {
+            pointer = refresh_function(pointer);
+        }
+        return;
+    }
+    for (size_t i = 0; i < num_pointers_; ++i) {
+        pointers_[i] = refresh_function(pointers_[i]);
+    }
+}
+
+void NodeTable::seal() {
+    if (sealed_) {
+        return;
+    }
+    // Position of every registered node once sorted by id
+    std::vector<uint32_t> order(num_nodes_);
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(pending_node_ids_.begin(), pending_node_ids_.end())) {
+        std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+            return pending_node_ids_[lhs] < pending_node_ids_[rhs];
+        });
+    }
+
+    node_ids_ = arena_->allocate<uint64_t>(num_nodes_);
+    element_offsets_ = arena_->allocate<uint64_t>(num_nodes_ + 1);
+    bases_ = arena_->allocate<const double* const*>(num_nodes_);
+    source_offsets_ = arena_->allocate<uint64_t>(num_nodes_);
+    num_pointers_ = pending_pointers_.size();
+    pointers_ = arena_->allocate<double*>(num_pointers_);
+    indices_ = arena_->allocate<uint32_t>(pending_indices_.size());
+    element_ids_ = arena_->allocate<uint32_t>(num_elements_);
+    if (!pending_weights_.empty()) {
+        pending_weights_.resize(num_elements_, 1.0);
+        weights_ = arena_->allocate<double>(num_elements_);
+    }
+
+    // Reuse pending_counts_ as the next free element of each slot, next_sources holds its next
+    // free pointer or index
+    std::vector<uint32_t> next_sources(num_nodes_);
+    size_t num_pointers = 0;
+    size_t num_indices = 0;
+    element_offsets_[0] = 0;
+    for (size_t node = 0; node < num_nodes_; ++node) {
+        const uint32_t slot = order[node];
+        node_ids_[node] = pending_node_ids_[slot];
+        bases_[node] = pending_bases_[slot];
+        size_t& num_sources = bases_[node] ? num_indices : num_pointers;
+        source_offsets_[node] = num_sources;
+        next_sources[slot] = static_cast<uint32_t>(num_sources);
+        num_sources += pending_counts_[slot];
+        element_offsets_[node + 1] = element_offsets_[node] + pending_counts_[slot];
+        pending_counts_[slot] = static_cast<uint32_t>(element_offsets_[node]);
+    }
+    // Stable placement keeps the registration order of the elements of each node
+    size_t next_pointer = 0;
+    size_t next_index = 0;
+    for (size_t i = 0; i < num_elements_; ++i) {
+        const uint32_t slot = pending_element_nodes_[i];
+        const uint32_t position = pending_counts_[slot]++;
+        const uint32_t source = next_sources[slot]++;
+        if (pending_bases_[slot]) {
+            indices_[source] = pending_indices_[next_index++];
+        } else {
+            pointers_[source] = pending_pointers_[next_pointer++];
+        }
+        element_ids_[position] = pending_element_ids_[i];
+        if (weights_) {
+            weights_[position] = pending_weights_[i];
+        }
+    }
+    if (sort_elements_) {
+        for (size_t node = 0; node < num_nodes_; ++node) {
+            sort_elements(node);
+        }
+    }
+
+    pending_lookup_ = {};
+    pending_node_ids_ = {};
+    pending_counts_ = {};
+    pending_bases_ = {};
+    pending_element_nodes_ = {};
+    pending_pointers_ = {};
+    pending_indices_ = {};
+    pending_element_ids_ = {};
+    pending_weights_ = {};
+    sealed_ = true;
+}
+
+void NodeTable::sort_elements(size_t node) {
+    const size_t begin = element_offsets_[node];
+    const size_t end = element_offsets_[node + 1];
+    if (std::is_sorted(element_ids_ + begin, element_ids_ + end)) {
+        return;
+    }
+    std::vector<size_t> order(end - begin);
+    std::iota(order.begin(), order.end(), begin);
+    std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return element_ids_[lhs] < element_ids_[rhs];
+    });
+    const size_t source = source_offsets_[node];
+    std::vector<double*> pointers;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> element_ids;
+    std::vector<double> weights;
+    for (size_t element : order) {
+        if (bases_[node]) {
+            indices.push_back(indices_[source + element - begin]);
+        } else {
+            pointers.push_back(pointers_[source + element - begin]);
+        }
+        element_ids.push_back(element_ids_[element]);
+        weights.push_back(get_weight(element));
+    }
+    std::copy(pointers.begin(), pointers.end(), pointers_ + source);
+    std::copy(indices.begin(), indices.end(), indices_ + source);
+    std::copy(element_ids.begin(), element_ids.end(), element_ids_ + begin);
+    if (weights_) {
+        std::copy(weights.begin(), weights.end(), weights_ + begin);
+    }
+}
+
+bool NodeTable::contains(uint64_t node_id) const {
+    if (!sealed_) {
+        return !pending_lookup_.empty() && pending_lookup_[find_pending(node_id)] != no_slot;
+    }
+    return find(node_id) != npos;
+}
+
+size_t NodeTable::find(uint64_t node_id) const noexcept {
+    const uint64_t* begin = node_ids_;
+    const uint64_t* end = node_ids_ + num_nodes_;
+    const uint64_t* it = std::lower_bound(begin, end, node_id);
+    return (it != end && *it == node_id) ? static_cast<size_t>(it - begin) : npos;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "arena.h"
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Nodes of a population stored as arrays: the node ids sorted in increasing order, the
+ * CSR offsets of their elements and one array per element attribute.
+ *
+ * Nodes and elements can be added in any order while the table is being filled. They are kept in
+ * registration order until seal() sorts them once into arrays allocated from the arena of the
+ * report, after which the table is read-only except for refresh_pointers.
+ *
+ * The elements of a node are either pointers to the simulator values, or positions in a single
+ * array registered in the ArrayRegistry. The two kinds are kept in separate arrays, so that indexed
+ * elements only take 4 bytes, and the base of a node tells which one holds its elements. Elements
+ * can be given a weight, 1 by default, for the reports summing them.
+ */
+class NodeTable
+{
+  public:
+    static constexpr uint32_t unlimited = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    /**
+     * \param sort_elements sort the elements of each node by id when sealing, keeping the
+     * registration order of the elements with the same id
+     */
+    explicit NodeTable(uint32_t max_elements_per_node = unlimited,
+                       std::shared_ptr<Arena> arena = std::make_shared<Arena>(),
+                       bool sort_elements = false);
+
+    /**
+     * \throws std::runtime_error if the node already exists
+     */
+    void add_node(uint64_t node_id);
+    void add_nodes(const uint64_t* node_ids, size_t num_nodes);
+    /**
+     * \throws std::out_of_range if the node doesn't exist, std::runtime_error if the node is full
+     * or has indexed elements
+     */
+    void add_element(uint64_t node_id, double* element_value, uint32_t element_id);
+    void add_weighted_element(uint64_t node_id,
+                              double* element_value,
+                              uint32_t element_id,
+                              double weight);
+    void add_elements(uint64_t node_id,
+                      double* const* element_values,
+                      const uint32_t* element_ids,
+                      size_t num_elements);
+    /**
+     * \brief Add the elements [offsets[i], offsets[i + 1]) of element_ids and element_values to
+     * the node node_ids[i], for every i < num_nodes
+     */
+    void add_elements(const uint64_t* node_ids,
+                      size_t num_nodes,
+                      const uint64_t* offsets,
+                      const uint32_t* element_ids,
+                      double* const* element_values);
+    /**
+     * \brief Add elements stored as positions of a simulator array
+     * \param base cell of the array in the ArrayRegistry, resolved at every recording
+     */
+    void add_indexed_elements(uint64_t node_id,
+                              const double* const* base,
+                              const uint32_t* indices,
+                              const uint32_t* element_ids,
+                              size_t num_elements);
+
+    void refresh_pointers(std::function<double*(double*)> refresh_function);
+
+    /**
+     * \brief Sort the nodes by id and move them to the arena. Does nothing if already sealed.
+     */
+    void seal();
+
+    bool is_sealed() const noexcept {
+        return sealed_;
+    }
+    bool contains(uint64_t node_id) const;
+    size_t size() const noexcept {
+        return num_nodes_;
+    }
+    bool empty() const noexcept {
+        return num_nodes_ == 0;
+    }
+    size_t get_num_elements() const noexcept {
+        return num_elements_;
+    }
+
+    // Accessors of a table not sealed yet, its elements in registration order
+    const std::vector<uint32_t>& get_pending_element_nodes() const noexcept {
+        return pending_element_nodes_;
+    }
+    const std::vector<uint32_t>& get_pending_element_ids() const noexcept {
+        return pending_element_ids_;
+    }
+
+    // Accessors of a sealed table, nodes are addressed by their position in increasing id order
+
+    /**
+     * \return position of node_id, or npos if it doesn't exist
+     */
+    size_t find(uint64_t node_id) const noexcept;
+    const uint64_t* get_node_ids() const noexcept {
+        return node_ids_;
+    }
+    uint64_t get_node_id(size_t node) const noexcept {
+        return node_ids_[node];
+    }
+    size_t get_element_begin(size_t node) const noexcept {
+        return element_offsets_[node];
+    }
+    size_t get_element_end(size_t node) const noexcept {
+        return element_offsets_[node + 1];
+    }
+    size_t get_num_elements(size_t node) const noexcept {
+        return element_offsets_[node + 1] - element_offsets_[node];
+    }
+    /**
+     * \return cell of the array of an indexed node, nullptr if its elements are pointers
+     */
+    const double* const* get_base(size_t node) const noexcept {
+        return bases_[node];
+    }
+    /**
+     * \return position of the first element of node in get_pointers() if it has no base, in
+     * get_indices() otherwise. The next elements of the node follow it.
+     */
+    size_t get_source_begin(size_t node) const noexcept {
+        return source_offsets_[node];
+    }
+    double* const* get_pointers() const noexcept {
+        return pointers_;
+    }
+    const uint32_t* get_indices() const noexcept {
+        return indices_;
+    }
+    const uint32_t* get_element_ids() const noexcept {
+        return element_ids_;
+    }
+    bool has_weights() const noexcept {
+        return weights_ != nullptr;
+    }
+    double get_weight(size_t element) const noexcept {
+        return weights_ ? weights_[element] : 1.0;
+    }
+    /**
+     * \brief Current address of the value of element, which belongs to node
+     */
+    const double* get_element_address(size_t node, size_t element) const noexcept {
+        const size_t source = source_offsets_[node] + (element - element_offsets_[node]);
+        return bases_[node] ? *bases_[node] + indices_[source] : pointers_[source];
+    }
+
+  private:
+    size_t find_pending(uint64_t node_id) const noexcept;
+    void reserve_pending(size_t num_nodes);
+    uint32_t get_pending_slot(uint64_t node_id) const;
+    void check_capacity(uint32_t slot, size_t num_elements) const;
+
+    uint32_t max_elements_per_node_;
+    std::shared_ptr<Arena> arena_;
+    bool sort_elements_;
+    bool sealed_ = false;
+    size_t num_nodes_ = 0;
+    size_t num_elements_ = 0;
+    size_t num_pointers_ = 0;
+
+    // Registration order, released by seal(). Nodes are found through an open addressing table of
+    // their slots, which grows by doubling instead of allocating once per node.
+    std::vector<uint32_t> pending_lookup_;
+    std::vector<uint64_t> pending_node_ids_;
+    std::vector<uint32_t> pending_counts_;
+    std::vector<const double* const*> pending_bases_;
+    std::vector<uint32_t> pending_element_nodes_;
+    std::vector<double*> pending_pointers_;
+    std::vector<uint32_t> pending_indices_;
+    std::vector<uint32_t> pending_element_ids_;
+    // Empty until an element is given a weight
+    std::vector<double> pending_weights_;
+
+    // Sealed arrays, owned by the arena
+    uint64_t* node_ids_ = nullptr;
+    uint64_t* element_offsets_ = nullptr;
+    const double* const** bases_ = nullptr;
+    uint64_t* source_offsets_ = nullptr;
+    double** pointers_ = nullptr;
+    uint32_t* indices_ = nullptr;
+    uint32_t* element_ids_ = nullptr;
+    double* weights_ = nullptr;
+
+    void sort_elements(size_t node);
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <limits>
+
+#include "running_statistics.h"
+
+namespace bbp {
+namespace sonata {
+
+void RunningStatistics::reset(size_t size) {
+    counts_.assign(size, 0);
+    min_.assign(size, std::numeric_limits<double>::infinity());
+    max_.assign(size, -std::numeric_limits<double>::infinity());
+    mean_.assign(size, 0.0);
+    squared_deviations_.assign(size, 0.0);
+}
+
+void RunningStatistics::update(size_t begin, size_t end, const double* values) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        const double value = values[i - begin];
+        const uint32_t count = ++counts_[i];
+        const double delta = value - mean_[i];
+        mean_[i] += delta / count;
+        squared_deviations_[i] += delta * (value - mean_[i]);
+        min_[i] = std::min(min_[i], value);
+        max_[i] = std::max(max_[i], value);
+    }
+}
+
+std::vector<double> RunningStatistics::with_counts(const std::vector<double>& values) const {
+    std::vector<double> result(values);
+    for (size_t i = 0; i < result.size(); ++i) {
+        if (counts_[i] == 0) {
+            result[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    return result;
+}
+
+std::vector<double> RunningStatistics::get_min() const {
+    return with_counts(min_);
+}
+
+std::vector<double> RunningStatistics::get_max() const {
+    return with_counts(max_);
+}
+
+std::vector<double> RunningStatistics::get_mean() const {
+    return with_counts(mean_);
+}
+
+std::vector<double> RunningStatistics::get_variance() const {
+    std::vector<double> variance(squared_deviations_.size());
+    for (size_t i = 0; i < variance.size(); ++i) {
+        variance[i] = counts_[i] == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                      : squared_deviations_[i] / counts_[i];
+    }
+    return variance;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Count, min, max, mean and variance of the values of every column of a report over the
+ * steps recorded, updated a step at a time with Welford's algorithm so that no step is kept
+ */
+class RunningStatistics
+{
+  public:
+    /**
+     * \brief Start again with size columns without any value
+     */
+    void reset(size_t size);
+    /**
+     * \brief Add the values of the columns [begin, end) of a step, values[0] being the one of
+     * begin. Disjoint ranges can be updated concurrently.
+     */
+    void update(size_t begin, size_t end, const double* values) noexcept;
+
+    size_t size() const noexcept {
+        return counts_.size();
+    }
+    const std::vector<uint32_t>& get_counts() const noexcept {
+        return counts_;
+    }
+    // Statistics of every column, NaN for the columns without values
+    std::vector<double> get_min() const;
+    std::vector<double> get_max() const;
+    std::vector<double> get_mean() const;
+    /**
+     * \brief Population variance, the mean of the squared deviations from the mean
+     */
+    std::vector<double> get_variance() const;
+
+  private:
+    std::vector<double> with_counts(const std::vector<double>& values) const;
+
+    std::vector<uint32_t> counts_;
+    std::vector<double> min_;
+    std::vector<double> max_;
+    std::vector<double> mean_;
+    // Sum of the squared deviations from the current mean
+    std::vector<double> squared_deviations_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <numeric>
 
 #include "../library/implementation_interface.hpp"
 #include "../library/sonatareport.h"
@@ -9,6 +11,66 @@
 namespace bbp {
 namespace sonata {
 
+namespace {
+
+uintptr_t first_element_address(const NodeTable& nodes, size_t node) {
+    if (nodes.get_num_elements(node) == 0) {
+        return 0;
+    }
+    return reinterpret_cast<uintptr_t>(
+        nodes.get_element_address(node, nodes.get_element_begin(node)));
+}
+
+// Populations below this size are recorded by the calling thread only
+constexpr size_t min_parallel_elements = 1 << 15;
+constexpr size_t cache_line_size = 64;
+// Largest default chunk of the report data, in bytes
+constexpr size_t max_default_chunk_size = 4194304;
+// Elements gathered at once before being accumulated in a window, 2 KB
+constexpr size_t window_block = 256;
+
+const char* get_sampling_name(Sampling sampling) {
+    switch (sampling) {
+    case Sampling::mean:
+        return "mean";
+    case Sampling::min:
+        return "min";
+    case Sampling::max:
+        return "max";
+    case Sampling::instantaneous:
+        break;
+    }
+    return "instantaneous";
+}
+
+// Separate loops for each sampling, so that they are vectorized
+void accumulate_values(Sampling sampling, const double* values, size_t count, double* window) {
+    switch (sampling) {
+    case Sampling::mean:
+        for (size_t i = 0; i < count; ++i) {
+            window[i] += values[i];
+        }
+        break;
+    case Sampling::min:
+        for (size_t i = 0; i < count; ++i) {
+            window[i] = values[i] < window[i] ? values[i] : window[i];
+        }
+        break;
+    case Sampling::max:
+        for (size_t i = 0; i < count; ++i) {
+            window[i] = values[i] > window[i] ? values[i] : window[i];
+        }
+        break;
+    case Sampling::instantaneous:
+        std::copy(values, values + count, window);
+        break;
+    }
+}
+
+}  // namespace
+
+constexpr uint32_t SonataData::no_slot;
+
 SonataData::SonataData(const std::string& report_name,
                        const std::string& population_name,
                        uint64_t population_offset,
@@ -18,16 +80,18 @@ SonataData::SonataData(const std::string& report_name,
                        double tstart,
                        double tend,
                        const std::string& units,
-                       std::shared_ptr<nodes_t> nodes,
+                       std::shared_ptr<NodeTable> nodes,
                        hid_t file_handler)
     : report_name_(report_name)
     , population_name_(population_name)
     , report_units_(units)
     , population_offset_(population_offset)
     , num_steps_(num_steps)
+    , max_buffer_size_(max_buffer_size)
     , hdf5_writer_(std::make_unique<HDF5Writer>(report_name, file_handler))
     , nodes_(nodes) {
-    prepare_buffer(max_buffer_size);
+    nodes_->seal();
+    total_elements_ = nodes_->get_num_elements();
     index_pointers_.resize(nodes->size());
 
     // Round the tstart value to avoid conflicts in case of save-restore
@@ -43,25 +107,29 @@ SonataData::SonataData(const std::string& report_name)
     , population_offset_(0)
     , hdf5_writer_(std::make_unique<HDF5Writer>(report_name)) {}
 
-void SonataData::prepare_buffer(size_t max_buffer_size) {
+SonataData::~SonataData() {
+    // The writer thread still refers to this population until its buffers are written
+    wait_for_writes();
+}
+
+std::vector<uint64_t> SonataData::get_local_counts() const {
+    // Ranks without elements still need to participate in the writings
+    uint32_t max_steps_to_write = (total_elements_ == 0)
+                                      ? std::numeric_limits<uint32_t>::max()
+                                      : max_buffer_size_ / (value_size_ * total_elements_);
+    return {total_elements_, nodes_->size(), max_steps_to_write};
+}
+
+void SonataData::prepare_buffer() {
     if (SonataReport::rank_ == 0) {
         logger->debug("PREPARING BUFFER for report {} and population {}",
                       report_name_,
                       population_name_);
     }
 
-    for (auto& kv : *nodes_) {
-        total_elements_ += kv.second->get_num_elements();
-    }
-
     // Calculate the timesteps that fit given the buffer size
     {
-        // Ranks without elements still need to participate in the writings
-        uint32_t max_steps_to_write = (total_elements_ == 0)
-                                          ? std::numeric_limits<uint32_t>::max()
-                                          : max_buffer_size / (sizeof(float) * total_elements_);
-        uint32_t common_max_steps_to_write =
-            Implementation::get_max_steps_to_write(report_name_, max_steps_to_write);
+        uint32_t common_max_steps_to_write = layout_.get_max_steps_to_write();
         if (common_max_steps_to_write < num_steps_) {  // More steps asked that buffer can contain
             if (common_max_steps_to_write < SonataReport::min_steps_to_record_) {
                 steps_to_write_ = SonataReport::min_steps_to_record_;
@@ -78,22 +146,87 @@ void SonataData::prepare_buffer(size_t max_buffer_size) {
     }
 
     remaining_steps_ = num_steps_;
+    // The sums and the values of the statistics are gathered in the window before being stored,
+    // as a window of a single step
+    if (uses_window()) {
+        window_.assign(total_elements_, 0.0);
+        window_steps_ = 0;
+        node_window_steps_.assign(nodes_->size(), 0);
+    }
+    if (statistics_ != Statistics::none) {
+        running_statistics_.reset(total_elements_);
+    }
 
     if (SonataReport::rank_ == 0) {
         logger->debug("\t- Total elements: {}", total_elements_);
         logger->debug("\t- Num steps: {}", num_steps_);
         logger->debug("\t- Steps to write: {}", steps_to_write_);
-        logger->debug("\t- Max Buffer size: {}", max_buffer_size);
+        logger->debug("\t- Max Buffer size: {}", max_buffer_size_);
     }
 
-    size_t buffer_size = total_elements_ * steps_to_write_;
-    report_buffer_.resize(buffer_size);
+    size_t buffer_size = writes_data() ? total_elements_ * steps_to_write_ * value_size_ : 0;
+    num_buffers_ = SonataReport::get_num_write_buffers();
+    report_buffer_ = allocate_buffer(buffer_size);
+    for (size_t i = 1; i < num_buffers_; ++i) {
+        free_buffers_.push_back(allocate_buffer(buffer_size));
+    }
 
     if (SonataReport::rank_ == 0) {
-        logger->debug("\t-Buffer size: {} (count={})",
-                      buffer_size * sizeof(report_buffer_[0]),
-                      buffer_size);
+        logger->debug("\t-Buffer size: {} (count={}) x {}",
+                      buffer_size,
+                      buffer_size / value_size_,
+                      num_buffers_);
+    }
+}
+
+storage_buffer_t SonataData::allocate_buffer(size_t buffer_size) {
+    storage_buffer_t buffer(buffer_size);
+    const size_t num_threads = get_num_threads();
+    if (num_threads == 1) {
+        std::fill(buffer.begin(), buffer.end(), 0);
+    } else {
+        // Every thread zeroes the part of each step it records, so that those pages are placed
+        // on its NUMA node
+        SonataReport::get_thread_pool().run([this, &buffer, num_threads](size_t thread) {
+            const auto part =
+                partition(total_elements_, thread, num_threads, get_cache_line_values());
+            for (size_t step = 0; step < steps_to_write_; ++step) {
+                uint8_t* slice = buffer.data() + step * total_elements_ * value_size_;
+                std::fill(slice + part.first * value_size_, slice + part.second * value_size_, 0);
+            }
+        });
+    }
+    return buffer;
+}
+
+size_t SonataData::get_cache_line_values() const noexcept {
+    return cache_line_size / value_size_;
+}
+
+report_buffer_t SonataData::get_report_buffer() const {
+    report_buffer_t values(report_buffer_.size() / value_size_);
+    visit_storage_type(storage_.type, [&](auto type) {
+        const auto* stored = reinterpret_cast<const decltype(type)*>(report_buffer_.data());
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = decode(stored[i], storage_);
+        }
+    });
+    return values;
+}
+
+std::vector<uint32_t> SonataData::get_element_ids() const {
+    if (summation_ != Summation::none) {
+        return summation_plan_.get_element_ids();
+    }
+    const NodeTable& nodes = *nodes_;
+    std::vector<uint32_t> element_ids;
+    element_ids.reserve(nodes.get_num_elements());
+    for (uint32_t node : ordered_nodes_) {
+        element_ids.insert(element_ids.end(),
+                           nodes.get_element_ids() + nodes.get_element_begin(node),
+                           nodes.get_element_ids() + nodes.get_element_end(node));
     }
+    return element_ids;
 }
 
 bool SonataData::is_due_to_report(double step) const noexcept {
@@ -110,11 +243,28 @@ bool SonataData::is_due_to_report(double step) const noexcept {
     return true;
 }
 
+bool SonataData::is_in_window(double step) const noexcept {
+    if (sampling_ == Sampling::instantaneous) {
+        return false;
+    }
+    return step > last_step_recorded_ - reporting_period_ && step < last_step_ &&
+           !is_due_to_report(step);
+}
+
 void SonataData::record_data(double step, const std::vector<uint64_t>& node_ids) {
+    record_nodes(step, node_ids.data(), node_ids.size());
+}
+
+void SonataData::record_data(double step, const int* node_ids, size_t num_nodes) {
+    record_nodes(step, node_ids, num_nodes);
+}
+
+template <typename T>
+void SonataData::record_nodes(double step, const T* node_ids, size_t num_nodes) {
     // Calculate the offset to write into the buffer
     uint32_t offset = static_cast<uint32_t>((step - last_step_recorded_) / reporting_period_);
     uint32_t local_position = last_position_ + total_elements_ * offset;
-    if (SonataReport::rank_ == 0) {
+    if (SonataReport::rank_ == 0 && num_nodes > 0) {
         logger->trace(
             "Recording data for population {}, step={} last_step_recorded={} steps recorded {} "
             "first node_id={} "
@@ -123,24 +273,51 @@ void SonataData::record_data(double step, const std::vector<uint64_t>& node_ids)
             population_name_,
             step,
             last_step_recorded_,
-            steps_recorded_,
+            steps_recorded_.load(),
             node_ids[0],
             report_buffer_.size(),
             local_position);
     }
-    for (auto& kv : *nodes_) {
-        uint64_t current_node_id = kv.second->get_node_id();
-        // Check if node is set to be recorded (found in nodeids)
-        if (std::find(node_ids.begin(), node_ids.end(), current_node_id) != node_ids.end()) {
-            kv.second->fill_data(report_buffer_.begin() + local_position);
-            nodes_recorded_.insert(current_node_id);
+    uint32_t newly_recorded = 0;
+    visit_storage_type(storage_.type, [&](auto type) {
+        using value_t = decltype(type);
+        auto* values = writes_data()
+                           ? reinterpret_cast<value_t*>(report_buffer_.data()) + local_position
+                           : nullptr;
+        for (size_t i = 0; i < num_nodes; ++i) {
+            // Skip the nodes of other populations
+            const uint32_t slot = get_node_slot(static_cast<uint64_t>(node_ids[i]));
+            if (slot == no_slot) {
+                continue;
+            }
+            if (!uses_window()) {
+                gather_plan_.gather_node(slot, values + gather_plan_.get_node_begin(slot));
+            } else {
+                const size_t begin = get_node_begin(slot);
+                const size_t end = get_node_begin(slot + 1);
+                accumulate_range(begin, end, node_window_steps_[slot] == 0);
+                store_window(begin, end, node_window_steps_[slot] + 1, values);
+                node_window_steps_[slot] = 0;
+            }
+            const uint64_t mask = uint64_t{1} << (slot % 64);
+            if ((nodes_recorded_[slot / 64].fetch_or(mask, std::memory_order_relaxed) & mask) ==
+                0) {
+                ++newly_recorded;
+            }
         }
-        local_position += kv.second->get_num_elements();
-    }
+    });
 
-    // Increase steps recorded when all nodes from specific rank has been already recorded
-    if (nodes_recorded_.size() == nodes_->size()) {
+    // Increase steps recorded when all nodes from specific rank has been already recorded. Only
+    // the call adding the last missing node sees the counter reach the total, and it starts the
+    // next step.
+    if (ordered_nodes_.empty()) {
         steps_recorded_++;
+    } else if (newly_recorded > 0 &&
+               num_nodes_recorded_.fetch_add(newly_recorded, std::memory_order_acq_rel) +
+                       newly_recorded ==
+                   ordered_nodes_.size()) {
+        steps_recorded_++;
+        clear_recorded_nodes();
     }
 }
 
@@ -154,10 +331,32 @@ void SonataData::record_data(double step) {
             report_buffer_.size(),
             local_position);
     }
-    for (auto& kv : *nodes_) {
-        kv.second->fill_data(report_buffer_.begin() + local_position);
-        local_position += kv.second->get_num_elements();
-    }
+    const size_t num_threads = get_num_threads();
+    visit_storage_type(storage_.type, [&](auto type) {
+        using value_t = decltype(type);
+        auto* slice = writes_data()
+                          ? reinterpret_cast<value_t*>(report_buffer_.data()) + local_position
+                          : nullptr;
+        // Each thread records the elements of its part, accumulated first in their windows
+        auto record_part = [this, slice](size_t begin, size_t end) {
+            if (!uses_window()) {
+                gather_plan_.gather(begin, end, slice + begin);
+            } else {
+                accumulate_range(begin, end, window_steps_ == 0);
+                store_window(begin, end, window_steps_ + 1, slice);
+            }
+        };
+        if (num_threads == 1) {
+            record_part(0, total_elements_);
+        } else {
+            SonataReport::get_thread_pool().run([this, &record_part, num_threads](size_t thread) {
+                const auto part =
+                    partition(total_elements_, thread, num_threads, get_cache_line_values());
+                record_part(part.first, part.second);
+            });
+        }
+    });
+    window_steps_ = 0;
     current_step_++;
     last_position_ += total_elements_;
     last_step_recorded_ += reporting_period_;
@@ -167,6 +366,128 @@ void SonataData::record_data(double step) {
     }
 }
 
+void SonataData::accumulate(const std::vector<uint64_t>& node_ids) {
+    accumulate_nodes(node_ids.data(), node_ids.size());
+}
+
+void SonataData::accumulate(const int* node_ids, size_t num_nodes) {
+    accumulate_nodes(node_ids, num_nodes);
+}
+
+template <typename T>
+void SonataData::accumulate_nodes(const T* node_ids, size_t num_nodes) {
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const uint32_t slot = get_node_slot(static_cast<uint64_t>(node_ids[i]));
+        if (slot == no_slot) {
+            continue;
+        }
+        accumulate_range(get_node_begin(slot),
+                         get_node_begin(slot + 1),
+                         node_window_steps_[slot] == 0);
+        ++node_window_steps_[slot];
+    }
+}
+
+void SonataData::accumulate(double step) {
+    if (SonataReport::rank_ == 0) {
+        logger->trace("Accumulating data for step={} in the window of step={}",
+                      step,
+                      last_step_recorded_);
+    }
+    const size_t num_threads = get_num_threads();
+    const bool first = window_steps_ == 0;
+    if (num_threads == 1) {
+        accumulate_range(0, total_elements_, first);
+    } else {
+        SonataReport::get_thread_pool().run([this, num_threads, first](size_t thread) {
+            const auto part =
+                partition(total_elements_, thread, num_threads, get_cache_line_values());
+            accumulate_range(part.first, part.second, first);
+        });
+    }
+    ++window_steps_;
+}
+
+size_t SonataData::get_node_begin(uint32_t slot) const noexcept {
+    return summation_ == Summation::none ? gather_plan_.get_node_begin(slot)
+                                         : summation_plan_.get_node_begin(slot);
+}
+
+void SonataData::gather_values(size_t begin, size_t end, double* out) const {
+    if (summation_ == Summation::none) {
+        gather_plan_.gather(begin, end, out);
+    } else {
+        sum_columns(begin, end, out);
+    }
+}
+
+void SonataData::sum_columns(size_t begin, size_t end, double* out) const {
+    // The terms of as many whole columns as fit in a block are gathered at once
+    double terms[window_block];
+    const SummationPlan& plan = summation_plan_;
+    size_t column = begin;
+    while (column < end) {
+        const size_t first = plan.get_term_begin(column);
+        size_t last = column + 1;
+        while (last < end && plan.get_term_begin(last + 1) - first <= window_block) {
+            ++last;
+        }
+        const size_t num_terms = plan.get_term_begin(last) - first;
+        if (num_terms <= window_block) {
+            gather_plan_.gather(first, first + num_terms, terms);
+            plan.sum(terms, column, last, out + (column - begin));
+        } else {
+            // A single column of more terms than a block
+            double sum = 0.0;
+            for (size_t term = first; term < first + num_terms; term += window_block) {
+                const size_t count = std::min(window_block, first + num_terms - term);
+                gather_plan_.gather(term, term + count, terms);
+                sum += plan.sum_terms(terms, term, count);
+            }
+            out[column - begin] = sum;
+        }
+        column = last;
+    }
+}
+
+void SonataData::accumulate_range(size_t begin, size_t end, bool first) {
+    double* window = window_.data();
+    if (first) {
+        gather_values(begin, end, window + begin);
+        return;
+    }
+    double block[window_block];
+    for (size_t i = begin; i < end; i += window_block) {
+        const size_t block_size = std::min(window_block, end - i);
+        gather_values(i, i + block_size, block);
+        accumulate_values(sampling_, block, block_size, window + i);
+    }
+}
+
+template <typename T>
+void SonataData::store_window(size_t begin, size_t end, uint32_t steps, T* out) {
+    double* window = window_.data() + begin;
+    if (sampling_ == Sampling::mean && steps > 1) {
+        const double inverse_steps = 1.0 / steps;
+        for (size_t i = 0; i < end - begin; ++i) {
+            window[i] *= inverse_steps;
+        }
+    }
+    if (statistics_ != Statistics::none) {
+        running_statistics_.update(begin, end, window);
+    }
+    if (writes_data()) {
+        gather_plan_.store(window, end - begin, out + begin);
+    }
+}
+
+size_t SonataData::get_num_threads() const {
+    if (total_elements_ < min_parallel_elements) {
+        return 1;
+    }
+    return SonataReport::get_thread_pool().size();
+}
+
 void SonataData::check_and_write(double timestep) {
     if (remaining_steps_ <= 0) {
         return;
@@ -181,7 +502,7 @@ void SonataData::check_and_write(double timestep) {
     current_step_ += steps_recorded_;
     last_position_ += total_elements_ * steps_recorded_;
     last_step_recorded_ += reporting_period_ * steps_recorded_;
-    nodes_recorded_.clear();
+    clear_recorded_nodes();
 
     // Write when buffer is full, finish all remaining recordings or when record several steps in a
     // row
@@ -197,7 +518,7 @@ void SonataData::check_and_write(double timestep) {
                 steps_to_write_,
                 current_step_,
                 remaining_steps_,
-                steps_recorded_);
+                steps_recorded_.load());
         }
         write_data();
     }
@@ -205,27 +526,44 @@ void SonataData::check_and_write(double timestep) {
 }
 
 void SonataData::prepare_dataset() {
+    const auto counts = Implementation::gather_counts(report_name_, get_local_counts());
+    prepare_dataset(PopulationLayout(counts, Implementation::get_rank(report_name_)));
+}
+
+void SonataData::prepare_dataset(const PopulationLayout& layout) {
+    layout_ = layout;
+    prepare_buffer();
     if (SonataReport::rank_ == 0) {
         logger->debug("PREPARING HEADER for report {} and population {}",
                       report_name_,
                       population_name_);
     }
+    const NodeTable& nodes = *nodes_;
+    ordered_nodes_.resize(nodes.size());
+    std::iota(ordered_nodes_.begin(), ordered_nodes_.end(), 0);
+    if (node_order_ == "by_address") {
+        std::stable_sort(ordered_nodes_.begin(),
+                         ordered_nodes_.end(),
+                         [&nodes](uint32_t lhs, uint32_t rhs) {
+                             return first_element_address(nodes, lhs) <
+                                    first_element_address(nodes, rhs);
+                         });
+    }
+
     // Prepare /report
-    for (auto& kv : *nodes_) {
-        // /report
-        const std::vector<uint32_t> element_ids = kv.second->get_element_ids();
-        element_ids_.insert(element_ids_.end(), element_ids.begin(), element_ids.end());
-        node_ids_.push_back(kv.second->get_node_id());
+    node_ids_.reserve(nodes.size());
+    for (uint32_t node : ordered_nodes_) {
+        node_ids_.push_back(nodes.get_node_id(node));
     }
-    int element_offset = Implementation::get_offset(report_name_, total_elements_);
+    prepare_node_slots();
+    update_gather_plan();
+    const hsize_t element_offset = layout_.get_elements().offset;
     logger->trace("\tRank {} - Total elements are: {} and element offset is: {}",
                   SonataReport::rank_,
                   total_elements_,
                   element_offset);
 
-    int last_writer = (total_elements_ == 0) ? -1 : SonataReport::rank_;
-    int last_rank = Implementation::get_last_rank(report_name_, last_writer);
-    if (SonataReport::rank_ == last_rank) {
+    if (layout_.is_last_writer()) {
         index_pointers_.resize(nodes_->size() + 1);
     }
 
@@ -234,15 +572,79 @@ void SonataData::prepare_dataset() {
         index_pointers_[0] = element_offset;
     }
     for (size_t i = 1; i < index_pointers_.size(); i++) {
-        uint64_t previous_node_id = node_ids_[i - 1];
         index_pointers_[i] = index_pointers_[i - 1] +
-                             nodes_->at(previous_node_id)->get_num_elements();
+                             (summation_ == Summation::none
+                                  ? nodes.get_num_elements(ordered_nodes_[i - 1])
+                                  : summation_plan_.get_node_begin(i) -
+                                        summation_plan_.get_node_begin(i - 1));
     }
 
     // All ranks need to participate in the write
     write_report_header();
 }
 
+void SonataData::prepare_node_slots() {
+    nodes_recorded_ = std::vector<std::atomic<uint64_t>>((ordered_nodes_.size() + 63) / 64);
+    num_nodes_recorded_ = 0;
+    dense_node_slots_.clear();
+    sparse_node_slots_.clear();
+    if (node_ids_.empty()) {
+        return;
+    }
+
+    const auto minmax = std::minmax_element(node_ids_.begin(), node_ids_.end());
+    min_node_id_ = *minmax.first;
+    const uint64_t span = *minmax.second - min_node_id_ + 1;
+    if (span <= 4 * node_ids_.size() + 64) {
+        dense_node_slots_.assign(span, no_slot);
+        for (uint32_t slot = 0; slot < node_ids_.size(); ++slot) {
+            dense_node_slots_[node_ids_[slot] - min_node_id_] = slot;
+        }
+    } else {
+        sparse_node_slots_.reserve(node_ids_.size());
+        for (uint32_t slot = 0; slot < node_ids_.size(); ++slot) {
+            sparse_node_slots_.emplace(node_ids_[slot], slot);
+        }
+    }
+}
+
+void SonataData::clear_recorded_nodes() noexcept {
+    for (auto& recorded : nodes_recorded_) {
+        recorded.store(0, std::memory_order_relaxed);
+    }
+    num_nodes_recorded_.store(0, std::memory_order_release);
+}
+
+uint32_t SonataData::get_node_slot(uint64_t node_id) const noexcept {
+    if (!dense_node_slots_.empty()) {
+        // Ids below min_node_id_ wrap around to large values
+        const uint64_t index = node_id - min_node_id_;
+        return index < dense_node_slots_.size() ? dense_node_slots_[index] : no_slot;
+    }
+    const auto it = sparse_node_slots_.find(node_id);
+    return it != sparse_node_slots_.end() ? it->second : no_slot;
+}
+
+void SonataData::set_summation(Summation summation) {
+    summation_ = summation;
+    total_elements_ = summation == Summation::none
+                          ? nodes_->get_num_elements()
+                          : SummationPlan::count_columns(*nodes_, summation == Summation::by_node);
+}
+
+void SonataData::update_gather_plan() {
+    gather_plan_.build(*nodes_, ordered_nodes_);
+    if (summation_ != Summation::none) {
+        summation_plan_.build(*nodes_, ordered_nodes_, summation_ == Summation::by_node);
+    }
+    gather_plan_.set_quantization(storage_.scale, storage_.offset);
+    logger->trace("\tRank {} - Gather plan of population {} has {} segments for {} elements",
+                  SonataReport::rank_,
+                  population_name_,
+                  gather_plan_.get_num_segments(),
+                  gather_plan_.size());
+}
+
 void SonataData::convert_gids_to_sonata(std::vector<uint64_t>& node_ids,
                                         uint64_t population_offset) {
     if (getenv("LIBSONATA_ZERO_BASED_GIDS") == nullptr) {
@@ -265,16 +667,66 @@ void SonataData::write_report_header() {
     hdf5_writer_->configure_group("/report");
     hdf5_writer_->configure_group(reports_population_group);
     hdf5_writer_->configure_group(reports_population_group + "/mapping");
-    hdf5_writer_->configure_dataset(reports_population_group + "/data",
-                                    num_steps_,
-                                    total_elements_);
-    hdf5_writer_->configure_attribute(reports_population_group + "/data", "units", report_units_);
+    Compression compression = compression_;
+    if (compression.is_chunked()) {
+        // A chunk per buffer and rank by default, written by a single H5Dwrite
+        if (compression.chunk_steps == 0) {
+            compression.chunk_steps = steps_to_write_;
+        }
+        if (compression.chunk_elements == 0) {
+            const uint64_t max_elements = max_default_chunk_size /
+                                          (value_size_ * std::max(compression.chunk_steps, 1u));
+            compression.chunk_elements = static_cast<uint32_t>(std::max<uint64_t>(
+                std::min(layout_.get_max_rank_elements(), max_elements), 1));
+        }
+    }
+    if (writes_data()) {
+        visit_storage_type(storage_.type, [&](auto type) {
+            hdf5_writer_->configure_dataset<decltype(type)>(reports_population_group + "/data",
+                                                            num_steps_,
+                                                            layout_.get_elements(),
+                                                            compression);
+        });
+        hdf5_writer_->configure_attribute(
+            reports_population_group + "/data", "units", report_units_);
+        if (sampling_ != Sampling::instantaneous) {
+            hdf5_writer_->configure_attribute(reports_population_group + "/data",
+                                              "sampling",
+                                              get_sampling_name(sampling_));
+        }
+        if (storage_.is_quantized()) {
+            // Decoded as stored * scale_factor + add_offset, as in the CF conventions
+            hdf5_writer_->configure_attribute(reports_population_group + "/data",
+                                              "scale_factor",
+                                              storage_.scale);
+            hdf5_writer_->configure_attribute(reports_population_group + "/data",
+                                              "add_offset",
+                                              storage_.offset);
+            // Only NaN is stored as the lowest integer, masked by the readers following the
+            // conventions
+            if (storage_.type == StorageType::int16) {
+                hdf5_writer_->configure_value_attribute(reports_population_group + "/data",
+                                                        "_FillValue",
+                                                        std::numeric_limits<int16_t>::lowest());
+            } else {
+                hdf5_writer_->configure_value_attribute(reports_population_group + "/data",
+                                                        "_FillValue",
+                                                        std::numeric_limits<int8_t>::lowest());
+            }
+        }
+    }
 
     std::vector<uint64_t> sonata_node_ids(node_ids_);
     convert_gids_to_sonata(sonata_node_ids, population_offset_);
-    hdf5_writer_->write(reports_population_group + "/mapping/node_ids", sonata_node_ids);
-    hdf5_writer_->write(reports_population_group + "/mapping/index_pointers", index_pointers_);
-    hdf5_writer_->write(reports_population_group + "/mapping/element_ids", element_ids_);
+    hdf5_writer_->write(reports_population_group + "/mapping/node_ids",
+                        sonata_node_ids,
+                        layout_.get_nodes());
+    hdf5_writer_->write(reports_population_group + "/mapping/index_pointers",
+                        index_pointers_,
+                        layout_.get_index_pointers());
+    hdf5_writer_->write(reports_population_group + "/mapping/element_ids",
+                        get_element_ids(),
+                        layout_.get_elements());
     hdf5_writer_->write_time(reports_population_group + "/mapping/time", time_);
     hdf5_writer_->configure_attribute(reports_population_group + "/mapping/time", "units", "ms");
 }
@@ -313,7 +765,7 @@ void SonataData::write_spike_populations() {
     }
 }
 
-void SonataData::write_data() {
+void SonataData::write_data(bool in_background) {
     if (remaining_steps_ <= 0) {  // Nothing left to write
         return;
     }
@@ -325,7 +777,17 @@ void SonataData::write_data() {
                       report_name_,
                       population_name_);
     }
-    hdf5_writer_->write_2D(report_buffer_, current_step_, total_elements_);
+    if (!writes_data()) {
+        // Only the statistics are written, at close
+    } else if (num_buffers_ > 1) {
+        write_buffer_async();
+    } else if (in_background && SonataReport::is_async_write_supported()) {
+        write_snapshot_async();
+    } else {
+        // A snapshot may still be written in the background, at the same offsets otherwise
+        SonataReport::wait_for_writer();
+        write_steps(report_buffer_, current_step_);
+    }
     remaining_steps_ -= current_step_;
     if (SonataReport::rank_ == 0) {
         logger->debug("\t-Steps written: {}", current_step_);
@@ -335,7 +797,80 @@ void SonataData::write_data() {
     current_step_ = 0;
 }
 
+void SonataData::write_buffer_async() {
+    submit_write(std::make_shared<storage_buffer_t>(std::move(report_buffer_)), true);
+
+    // Keep recording into the next buffer, waiting if all of them are still being written
+    std::unique_lock<std::mutex> lock(buffers_mutex_);
+    buffer_written_.wait(lock, [this] { return !free_buffers_.empty(); });
+    report_buffer_ = std::move(free_buffers_.front());
+    free_buffers_.pop_front();
+}
+
+void SonataData::write_snapshot_async() {
+    // Only the steps recorded so far, the single buffer being filled again meanwhile
+    auto snapshot = std::make_shared<storage_buffer_t>(
+        report_buffer_.begin(),
+        report_buffer_.begin() + current_step_ * total_elements_ * value_size_);
+    submit_write(snapshot, false);
+}
+
+void SonataData::submit_write(std::shared_ptr<storage_buffer_t> buffer, bool reuse) {
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        ++pending_writes_;
+    }
+    // std::function needs a copyable task, hence the shared buffer
+    const uint32_t steps_to_write = current_step_;
+    SonataReport::get_writer_thread().submit([this, buffer, reuse, steps_to_write] {
+        write_steps(*buffer, steps_to_write);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (reuse) {
+            free_buffers_.push_back(std::move(*buffer));
+        }
+        --pending_writes_;
+        buffer_written_.notify_all();
+    });
+}
+
+void SonataData::write_steps(const storage_buffer_t& buffer, uint32_t steps_to_write) {
+    visit_storage_type(storage_.type, [&](auto type) {
+        hdf5_writer_->write_2D(reinterpret_cast<const decltype(type)*>(buffer.data()),
+                               steps_to_write,
+                               total_elements_);
+    });
+}
+
+void SonataData::wait_for_writes() {
+    std::unique_lock<std::mutex> lock(buffers_mutex_);
+    buffer_written_.wait(lock, [this] { return pending_writes_ == 0; });
+}
+
+void SonataData::write_statistics() {
+    const std::string statistics_group = "/report/" + population_name_ + "/statistics";
+    const RunningStatistics& statistics = running_statistics_;
+    hdf5_writer_->configure_group(statistics_group);
+    hdf5_writer_->write(statistics_group + "/count",
+                        statistics.get_counts(),
+                        layout_.get_elements());
+    hdf5_writer_->write(statistics_group + "/min", statistics.get_min(), layout_.get_elements());
+    hdf5_writer_->write(statistics_group + "/max", statistics.get_max(), layout_.get_elements());
+    hdf5_writer_->write(statistics_group + "/mean", statistics.get_mean(), layout_.get_elements());
+    hdf5_writer_->write(statistics_group + "/variance",
+                        statistics.get_variance(),
+                        layout_.get_elements());
+    for (const char* name : {"/min", "/max", "/mean"}) {
+        hdf5_writer_->configure_attribute(statistics_group + name, "units", report_units_);
+    }
+}
+
 void SonataData::close() {
+    wait_for_writes();
+    // The writes of the other populations would run along the statistics and the close
+    SonataReport::wait_for_writer();
+    if (statistics_ != Statistics::none) {
+        write_statistics();
+    }
     hdf5_writer_->close();
 }
 
@@ -1,9 +1,19 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
 #include <map>
-#include <set>
+#include <mutex>
+#include <unordered_map>
 
 #include "../io/hdf5_writer.h"
-#include "node.h"
+#include "../utils/default_init_allocator.h"
+#include "gather_plan.h"
+#include "node_table.h"
+#include "running_statistics.h"
+#include "storage.h"
+#include "summation_plan.h"
 
 namespace bbp {
 namespace sonata {
@@ -50,6 +60,28 @@ class Population
     std::vector<uint64_t> spike_node_ids_;
 };
 
+using report_buffer_t = std::vector<float, DefaultInitAllocator<float>>;
+// Steps of a population as stored, values of the type given by its Storage
+using storage_buffer_t = std::vector<uint8_t, DefaultInitAllocator<uint8_t>>;
+
+/**
+ * \brief Value recorded for each element at a reporting step: its value at that step, or the
+ * mean, min or max of its values over the steps of the reporting period ending at that step
+ */
+enum class Sampling { instantaneous, mean, min, max };
+
+/**
+ * \brief Values written for the elements of a population: every element, the sum of the
+ * consecutive elements of a node with the same id or the sum of all the elements of a node
+ */
+enum class Summation { none, by_element, by_node };
+
+/**
+ * \brief Whether the min, max, mean and variance of every element over the whole report are
+ * written at close, along with its data or instead of it
+ */
+enum class Statistics { none, with_data, without_data };
+
 class SonataData
 {
   public:
@@ -62,28 +94,120 @@ class SonataData
                double tstart,
                double tend,
                const std::string& units,
-               std::shared_ptr<nodes_t> nodes,
+               std::shared_ptr<NodeTable> nodes,
                hid_t file_handler);
 
     SonataData(const std::string& report_name);
+    ~SonataData();
 
+    /**
+     * \brief Set the order of the nodes in the buffer and the mapping of the report: "by_id"
+     * (default) or "by_address", following the address of the first element of each node so that
+     * recording walks the simulator memory monotonically. Must be called before prepare_dataset.
+     */
+    void set_node_order(const std::string& node_order) noexcept {
+        node_order_ = node_order;
+    }
+    /**
+     * \brief Set the type of the values in the buffers and in the file, quantized while being
+     * gathered if integers. Must be called before prepare_dataset.
+     */
+    void set_storage(const Storage& storage) noexcept {
+        storage_ = storage;
+        value_size_ = get_value_size(storage.type);
+    }
+    /**
+     * \brief Set how the elements are sampled, see is_in_window. Must be called before
+     * prepare_dataset.
+     */
+    void set_sampling(Sampling sampling) noexcept {
+        sampling_ = sampling;
+    }
+    /**
+     * \brief Set the columns of the report, summed with the weights of the elements. Must be
+     * called before get_local_counts.
+     */
+    void set_summation(Summation summation);
+    /**
+     * \brief Set whether statistics of the values recorded, once sampled and summed, are kept and
+     * written under /report/<population>/statistics at close. Must be called before
+     * prepare_dataset.
+     */
+    void set_statistics(Statistics statistics) noexcept {
+        statistics_ = statistics;
+    }
+    const RunningStatistics& get_statistics() const noexcept {
+        return running_statistics_;
+    }
+    /**
+     * \brief Set the chunks and filters of the data of the population, the chunk sizes left to 0
+     * defaulting to the steps of a buffer and to the elements of the largest rank. Must be called
+     * before prepare_dataset.
+     */
+    void set_compression(const Compression& compression) noexcept {
+        compression_ = compression;
+    }
+    /**
+     * \brief Sizes of the population on this rank, to be exchanged with the other ranks of the
+     * report into the PopulationLayout given to prepare_dataset
+     */
+    std::vector<uint64_t> get_local_counts() const;
+    /**
+     * \brief Allocate the buffers and write the mapping of the population
+     */
+    void prepare_dataset(const PopulationLayout& layout);
+    /**
+     * \brief Same as above, exchanging the counts of this population only
+     */
     void prepare_dataset();
+    void update_gather_plan();
     void write_report_header();
     void write_spikes_header(Population& population);
     void write_spike_populations();
     void add_population(std::unique_ptr<Population>&& population);
 
-    void write_data();
+    /**
+     * \brief Write the steps recorded so far. With in_background, a copy of them is written by the
+     * writer thread if it can be used, to be waited for with wait_for_writes.
+     */
+    void write_data(bool in_background = false);
+    /**
+     * \brief Wait until the writer thread has written all the buffers given to it
+     */
+    void wait_for_writes();
     void close();
 
     bool is_due_to_report(double step) const noexcept;
+    /**
+     * \brief Whether the step is in the reporting period of the next step due to report without
+     * being due itself, its values to be accumulated into those recorded at the end of the period.
+     * Always false with instantaneous sampling.
+     */
+    bool is_in_window(double step) const noexcept;
+    /**
+     * \brief Record the given nodes of the population, ignoring the ids of other populations.
+     * Can be called concurrently by several threads as long as they record disjoint sets of nodes
+     * and all the calls of a step return before the first call of the next step.
+     */
     void record_data(double step, const std::vector<uint64_t>& node_ids);
+    void record_data(double step, const int* node_ids, size_t num_nodes);
     void record_data(double step);
+    /**
+     * \brief Accumulate the values of a step in the window of the next step recorded, for the
+     * steps in a window. The node versions can be called concurrently as record_data.
+     */
+    void accumulate(const std::vector<uint64_t>& node_ids);
+    void accumulate(const int* node_ids, size_t num_nodes);
+    void accumulate(double step);
     void check_and_write(double timestep);
     void convert_gids_to_sonata(std::vector<uint64_t>& node_ids, uint64_t population_offset);
 
-    const std::vector<float>& get_report_buffer() const noexcept {
-        return report_buffer_;
+    /**
+     * \brief Copy of the buffer being recorded, decoded to floats
+     */
+    report_buffer_t get_report_buffer() const;
+    const void* get_report_data() const noexcept {
+        return report_buffer_.data();
     }
 
     const std::vector<uint64_t>& get_node_ids() const noexcept {
@@ -92,21 +216,25 @@ class SonataData
     const std::vector<uint64_t>& get_index_pointers() const noexcept {
         return index_pointers_;
     }
-    const std::vector<uint32_t>& get_element_ids() const noexcept {
-        return element_ids_;
-    }
+    /**
+     * \brief Element ids of the mapping, built from the node table when asked for
+     */
+    std::vector<uint32_t> get_element_ids() const;
 
   private:
     std::string report_name_;
     std::string population_name_;
     std::string report_units_;
     uint64_t population_offset_;
-    std::vector<float> report_buffer_;
+    storage_buffer_t report_buffer_;
+    Storage storage_;
+    size_t value_size_ = sizeof(float);
     uint32_t total_elements_ = 0;
     uint32_t num_steps_ = 0;
+    size_t max_buffer_size_ = 0;
     uint32_t steps_to_write_ = 0;
     uint32_t current_step_ = 0;
-    uint32_t steps_recorded_ = 0;
+    std::atomic<uint32_t> steps_recorded_{0};
     uint32_t last_position_ = 0;
     uint32_t remaining_steps_ = 0;
     uint32_t reporting_period_ = 0;
@@ -115,15 +243,90 @@ class SonataData
 
     std::vector<uint64_t> node_ids_;
     std::vector<uint64_t> index_pointers_;
-    std::vector<uint32_t> element_ids_;
     std::array<double, 3> time_;
 
-    std::set<uint64_t> nodes_recorded_;
+    // Slot of each node id in ordered_nodes_: dense table starting at min_node_id_ when the ids
+    // are compact enough, hash table otherwise
+    static constexpr uint32_t no_slot = std::numeric_limits<uint32_t>::max();
+    uint64_t min_node_id_ = 0;
+    std::vector<uint32_t> dense_node_slots_;
+    std::unordered_map<uint64_t, uint32_t> sparse_node_slots_;
+    // One bit per slot, set once the node has been recorded in the current step. Updated without
+    // locks so that simulator threads can record disjoint sets of nodes concurrently.
+    std::vector<std::atomic<uint64_t>> nodes_recorded_;
+    std::atomic<uint32_t> num_nodes_recorded_{0};
+
     const std::unique_ptr<HDF5Writer> hdf5_writer_;
-    std::shared_ptr<nodes_t> nodes_;
+    std::shared_ptr<NodeTable> nodes_;
+    std::string node_order_ = "by_id";
+    Compression compression_;
+    Sampling sampling_ = Sampling::instantaneous;
+    Summation summation_ = Summation::none;
+    SummationPlan summation_plan_;
+    Statistics statistics_ = Statistics::none;
+    RunningStatistics running_statistics_;
+    // Mean (as a sum), min or max of every element over the steps accumulated in the window of
+    // the next recorded step, and the number of those steps for the whole population and for
+    // every node recorded on its own
+    std::vector<double> window_;
+    uint32_t window_steps_ = 0;
+    std::vector<uint32_t> node_window_steps_;
+    // Positions in nodes_ of the nodes in buffer order
+    std::vector<uint32_t> ordered_nodes_;
+    GatherPlan gather_plan_;
+    PopulationLayout layout_;
     std::vector<std::unique_ptr<Population>> populations_;
 
-    void prepare_buffer(size_t max_buffer_size);
+    // Buffers already written, oldest first, to be filled once report_buffer_ is full
+    size_t num_buffers_ = 1;
+    std::deque<storage_buffer_t> free_buffers_;
+    size_t pending_writes_ = 0;
+    std::mutex buffers_mutex_;
+    std::condition_variable buffer_written_;
+
+    // Whether the values go through the window before being stored
+    bool uses_window() const noexcept {
+        return sampling_ != Sampling::instantaneous || summation_ != Summation::none ||
+               statistics_ != Statistics::none;
+    }
+    bool writes_data() const noexcept {
+        return statistics_ != Statistics::without_data;
+    }
+    void prepare_buffer();
+    storage_buffer_t allocate_buffer(size_t buffer_size);
+    void write_buffer_async();
+    void write_snapshot_async();
+    void submit_write(std::shared_ptr<storage_buffer_t> buffer, bool reuse);
+    void write_steps(const storage_buffer_t& buffer, uint32_t steps_to_write);
+    size_t get_num_threads() const;
+    // Values per cache line, so that two threads never write the same line of a step
+    size_t get_cache_line_values() const noexcept;
+    template <typename T>
+    void record_nodes(double step, const T* node_ids, size_t num_nodes);
+    template <typename T>
+    void accumulate_nodes(const T* node_ids, size_t num_nodes);
+    // Buffer position of the first value of a node
+    size_t get_node_begin(uint32_t slot) const noexcept;
+    /**
+     * \brief Read the values [begin, end) of the current step, either elements or their sums
+     */
+    void gather_values(size_t begin, size_t end, double* out) const;
+    void sum_columns(size_t begin, size_t end, double* out) const;
+    /**
+     * \brief Accumulate the values [begin, end) of the current step in the window, starting it
+     * again if first
+     */
+    void accumulate_range(size_t begin, size_t end, bool first);
+    /**
+     * \brief Store the window of the elements [begin, end) accumulated over steps steps into
+     * out + begin, adding them to the statistics. Nothing is stored without data.
+     */
+    template <typename T>
+    void store_window(size_t begin, size_t end, uint32_t steps, T* out);
+    void write_statistics();
+    void prepare_node_slots();
+    void clear_recorded_nodes() noexcept;
+    uint32_t get_node_slot(uint64_t node_id) const noexcept;
 };
 
 }  // namespace sonata
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Type of the values of a report in its buffers and in its file. The integer types hold
+ * quantized values, decoded as stored * scale + offset.
+ */
+enum class StorageType { float32, float64, float16, int16, int8 };
+
+/**
+ * \brief IEEE 754 half precision value, stored as its bits as there is no such C++ type
+ */
+struct float16 {
+    uint16_t bits;
+};
+
+struct Storage {
+    StorageType type = StorageType::float32;
+    // Step between two quantized values, twice the largest error, and value stored as 0
+    double scale = 1.0;
+    double offset = 0.0;
+
+    bool is_quantized() const noexcept {
+        return type == StorageType::int16 || type == StorageType::int8;
+    }
+};
+
+/**
+ * \brief Call functor(T()) with the C++ type T of the values stored as type, so that the code
+ * handling the values is specialized for each type at compile time
+ */
+template <typename Functor>
+void visit_storage_type(StorageType type, Functor&& functor) {
+    switch (type) {
+    case StorageType::float64:
+        functor(double());
+        break;
+    case StorageType::float16:
+        functor(float16());
+        break;
+    case StorageType::int16:
+        functor(int16_t());
+        break;
+    case StorageType::int8:
+        functor(int8_t());
+        break;
+    case StorageType::float32:
+        functor(float());
+        break;
+    }
+}
+
+inline size_t get_value_size(StorageType type) noexcept {
+    size_t size = 0;
+    visit_storage_type(type, [&size](auto value) { size = sizeof(value); });
+    return size;
+}
+
+/**
+ * \brief Round a float to the nearest half, ties to even as the F16C instructions do. Values too
+ * large for a half are infinite, NaN stays NaN.
+ */
+inline float16 to_float16(float value) noexcept {
+    const uint32_t half_overflow = (127 + 16) << 23;
+    const uint32_t half_subnormal = 113 << 23;
+    // Adding it leaves the subnormal half in the low bits of the float, rounded by the FPU
+    const uint32_t subnormal_magic = ((127 - 15) + (23 - 10) + 1) << 23;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    uint16_t half;
+    if (bits >= half_overflow) {
+        half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < half_subnormal) {
+        float magic;
+        std::memcpy(&magic, &subnormal_magic, sizeof(magic));
+        float shifted;
+        std::memcpy(&shifted, &bits, sizeof(shifted));
+        shifted += magic;
+        std::memcpy(&bits, &shifted, sizeof(bits));
+        half = static_cast<uint16_t>(bits - subnormal_magic);
+    } else {
+        const uint32_t odd_mantissa = (bits >> 13) & 1;
+        // Rebias the exponent and round the 13 dropped bits
+        bits += (uint32_t(15 - 127) << 23) + 0xfff + odd_mantissa;
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return {static_cast<uint16_t>(half | (sign >> 16))};
+}
+
+inline float to_float(float16 value) noexcept {
+    const uint32_t sign = uint32_t(value.bits & 0x8000) << 16;
+    const uint32_t exponent = (value.bits >> 10) & 0x1f;
+    uint32_t mantissa = value.bits & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        // Subnormal half, normalized as a float
+        uint32_t float_exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            --float_exponent;
+        }
+        bits = sign | (float_exponent << 23) | ((mantissa & 0x3ff) << 13);
+    } else {
+        bits = sign;
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/**
+ * \brief Value recorded as the stored value
+ */
+template <typename T>
+double decode(T value, const Storage& storage) noexcept {
+    return storage.is_quantized() ? value * storage.scale + storage.offset : value;
+}
+
+inline double decode(float16 value, const Storage&) noexcept {
+    return to_float(value);
+}
+
+}  // namespace sonata
+}  // namespace bbp
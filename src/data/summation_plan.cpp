@@ -0,0 +1,116 @@
+#include <algorithm>
+
+#include "summation_plan.h"
+
+namespace bbp {
+namespace sonata {
+
+namespace {
+
+// Sum with independent partial sums, which the compiler keeps in vector registers without
+// reassociating the additions itself
+double sum_values(const double* values, size_t count) {
+    double partial[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            partial[lane] += values[i + lane];
+        }
+    }
+    double sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    for (; i < count; ++i) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+double sum_weighted_values(const double* values, const double* weights, size_t count) {
+    double partial[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            partial[lane] += values[i + lane] * weights[i + lane];
+        }
+    }
+    double sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    for (; i < count; ++i) {
+        sum += values[i] * weights[i];
+    }
+    return sum;
+}
+
+}  // namespace
+
+void SummationPlan::build(const NodeTable& nodes,
+                          const std::vector<uint32_t>& order,
+                          bool by_node) {
+    term_begins_.clear();
+    node_begins_.clear();
+    element_ids_.clear();
+    weights_.clear();
+    node_begins_.reserve(order.size() + 1);
+    size_t term = 0;
+    for (uint32_t node : order) {
+        node_begins_.push_back(element_ids_.size());
+        const uint32_t* ids = nodes.get_element_ids();
+        for (size_t i = nodes.get_element_begin(node); i < nodes.get_element_end(node); ++i) {
+            const bool new_column = by_node ? i == nodes.get_element_begin(node)
+                                            : i == nodes.get_element_begin(node) ||
+                                                  ids[i] != ids[i - 1];
+            if (new_column) {
+                term_begins_.push_back(term);
+                element_ids_.push_back(by_node ? 0 : ids[i]);
+            }
+            if (nodes.has_weights()) {
+                weights_.push_back(nodes.get_weight(i));
+            }
+            ++term;
+        }
+    }
+    node_begins_.push_back(element_ids_.size());
+    term_begins_.push_back(term);
+}
+
+size_t SummationPlan::count_columns(const NodeTable& nodes, bool by_node) {
+    if (!nodes.is_sealed()) {
+        // Distinct pairs of node and element id, the elements of a node being in any order
+        const std::vector<uint32_t>& element_nodes = nodes.get_pending_element_nodes();
+        const std::vector<uint32_t>& ids = nodes.get_pending_element_ids();
+        std::vector<uint64_t> keys(element_nodes.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            keys[i] = (uint64_t(element_nodes[i]) << 32) | (by_node ? 0 : ids[i]);
+        }
+        std::sort(keys.begin(), keys.end());
+        return static_cast<size_t>(std::unique(keys.begin(), keys.end()) - keys.begin());
+    }
+    size_t columns = 0;
+    const uint32_t* ids = nodes.get_element_ids();
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        for (size_t i = nodes.get_element_begin(node); i < nodes.get_element_end(node); ++i) {
+            if (i == nodes.get_element_begin(node) || (!by_node && ids[i] != ids[i - 1])) {
+                ++columns;
+            }
+        }
+    }
+    return columns;
+}
+
+void SummationPlan::sum(const double* terms, size_t begin, size_t end, double* out) const {
+    const size_t first = term_begins_[begin];
+    for (size_t column = begin; column < end; ++column) {
+        const size_t term = term_begins_[column];
+        out[column - begin] = sum_terms(terms + (term - first),
+                                        term,
+                                        term_begins_[column + 1] - term);
+    }
+}
+
+double SummationPlan::sum_terms(const double* terms, size_t first, size_t count) const {
+    if (weights_.empty()) {
+        return sum_values(terms, count);
+    }
+    return sum_weighted_values(terms, weights_.data() + first, count);
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "node_table.h"
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Sum of the elements of a population into fewer values, the columns of the report: one
+ * per node, or one per run of consecutive elements of a node with the same id. The elements are
+ * the terms of the sums, weighted by their weights and laid out as in the GatherPlan built with the
+ * same order, so that the terms of a column are consecutive.
+ */
+class SummationPlan
+{
+  public:
+    /**
+     * \param by_node sum all the elements of a node into a single column
+     */
+    void build(const NodeTable& nodes, const std::vector<uint32_t>& order, bool by_node);
+
+    /**
+     * \brief Number of columns of the nodes of a table, whatever their order. The table is left
+     * as it is when not sealed yet, its elements being counted in registration order.
+     */
+    static size_t count_columns(const NodeTable& nodes, bool by_node);
+
+    /**
+     * \brief Sum the terms of the columns [begin, end) into out[0, end - begin), terms starting
+     * with the first term of begin
+     */
+    void sum(const double* terms, size_t begin, size_t end, double* out) const;
+    /**
+     * \brief Weighted sum of the values of the count terms of a column from the term first
+     */
+    double sum_terms(const double* terms, size_t first, size_t count) const;
+
+    size_t size() const noexcept {
+        return term_begins_.empty() ? 0 : term_begins_.size() - 1;
+    }
+    size_t get_term_begin(size_t column) const noexcept {
+        return term_begins_[column];
+    }
+    size_t get_node_begin(size_t node) const noexcept {
+        return node_begins_[node];
+    }
+    /**
+     * \brief Element id of every column, 0 for the columns of whole nodes
+     */
+    const std::vector<uint32_t>& get_element_ids() const noexcept {
+        return element_ids_;
+    }
+
+  private:
+    // First term of each column plus the total, first column of each node plus the total
+    std::vector<size_t> term_begins_;
+    std::vector<size_t> node_begins_;
+    std::vector<uint32_t> element_ids_;
+    // Empty if every weight is 1
+    std::vector<double> weights_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
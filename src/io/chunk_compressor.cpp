@@ -0,0 +1,104 @@
+#include "chunk_compressor.h"
+
+#ifdef SONATA_REPORT_HAVE_DIRECT_CHUNK_WRITE
+#include <algorithm>
+#include <zlib.h>
+
+namespace bbp {
+namespace sonata {
+
+ChunkCompressor::ChunkCompressor(int level,
+                                 size_t value_size,
+                                 const std::array<hsize_t, 2>& chunk,
+                                 const std::array<hsize_t, 2>& dims)
+    : level_(level)
+    , value_size_(value_size)
+    , chunk_(chunk)
+    , dims_(dims) {}
+
+bool ChunkCompressor::is_aligned(hsize_t first_step, hsize_t steps) const noexcept {
+    return first_step % chunk_[0] == 0 &&
+           (steps % chunk_[0] == 0 || first_step + steps == dims_[0]);
+}
+
+bool ChunkCompressor::write(hid_t dataset,
+                            const void* buffer,
+                            hsize_t first_step,
+                            hsize_t steps,
+                            ThreadPool& pool) const {
+    const hsize_t chunk_rows = (steps + chunk_[0] - 1) / chunk_[0];
+    const hsize_t chunk_columns = (dims_[1] + chunk_[1] - 1) / chunk_[1];
+    std::vector<std::vector<uint8_t>> chunks(chunk_rows * chunk_columns);
+    pool.run([&](size_t thread) {
+        const auto part = partition(chunks.size(), thread, pool.size());
+        std::vector<uint8_t> values;
+        std::vector<uint8_t> bytes;
+        for (size_t i = part.first; i < part.second; ++i) {
+            chunks[i] = compress_chunk(static_cast<const uint8_t*>(buffer),
+                                       steps,
+                                       i / chunk_columns * chunk_[0],
+                                       i % chunk_columns * chunk_[1],
+                                       values,
+                                       bytes);
+        }
+    });
+
+    // HDF5 is not thread safe, so the chunks are written by the caller only
+    bool written = true;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        std::array<hsize_t, 2> offset = {first_step + i / chunk_columns * chunk_[0],
+                                         i % chunk_columns * chunk_[1]};
+        written &= !chunks[i].empty() && H5Dwrite_chunk(dataset,
+                                                        H5P_DEFAULT,
+                                                        0,
+                                                        offset.data(),
+                                                        chunks[i].size(),
+                                                        chunks[i].data()) >= 0;
+    }
+    return written;
+}
+
+void ChunkCompressor::shuffle(const uint8_t* values,
+                              size_t size,
+                              size_t value_size,
+                              uint8_t* bytes) noexcept {
+    for (size_t byte = 0; byte < value_size; ++byte) {
+        for (size_t i = 0; i < size; ++i) {
+            bytes[byte * size + i] = values[i * value_size + byte];
+        }
+    }
+}
+
+std::vector<uint8_t> ChunkCompressor::compress_chunk(const uint8_t* buffer,
+                                                     hsize_t steps,
+                                                     hsize_t step,
+                                                     hsize_t element,
+                                                     std::vector<uint8_t>& values,
+                                                     std::vector<uint8_t>& bytes) const {
+    // Full chunks even at the end of the dataset, as HDF5 stores them
+    const size_t num_values = chunk_[0] * chunk_[1];
+    values.assign(num_values * value_size_, 0);
+    const hsize_t num_steps = std::min(chunk_[0], steps - step);
+    const hsize_t num_elements = std::min(chunk_[1], dims_[1] - element);
+    for (hsize_t i = 0; i < num_steps; ++i) {
+        const uint8_t* row = buffer + ((step + i) * dims_[1] + element) * value_size_;
+        std::copy(row,
+                  row + num_elements * value_size_,
+                  values.begin() + i * chunk_[1] * value_size_);
+    }
+    bytes.resize(values.size());
+    shuffle(values.data(), num_values, value_size_, bytes.data());
+
+    uLongf size = compressBound(bytes.size());
+    std::vector<uint8_t> chunk(size);
+    if (compress2(chunk.data(), &size, bytes.data(), bytes.size(), level_) != Z_OK) {
+        size = 0;
+    }
+    chunk.resize(size);
+    return chunk;
+}
+
+}  // namespace sonata
+}  // namespace bbp
+
+#endif
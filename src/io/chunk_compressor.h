@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <hdf5.h>
+#include <vector>
+
+#include "../utils/thread_pool.h"
+
+// Direct chunk writes need zlib for the deflate filter and HDF5 1.10.3, and aren't supported by
+// parallel HDF5
+#if defined(SONATA_REPORT_HAVE_ZLIB) && !defined(SONATA_REPORT_HAVE_MPI) && H5_VERSION_GE(1, 10, 3)
+#define SONATA_REPORT_HAVE_DIRECT_CHUNK_WRITE
+#endif
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Shuffles and deflates the chunks of a 2D dataset as the HDF5 shuffle and deflate
+ * filters would, on several threads, and writes them with H5Dwrite_chunk. The dataset must be
+ * created with those two filters, so that any HDF5 reader decompresses it.
+ */
+class ChunkCompressor
+{
+  public:
+    /**
+     * \param level deflate level from 1 to 9
+     * \param value_size bytes of a value
+     * \param chunk steps and elements of a chunk
+     * \param dims steps and elements of the dataset
+     */
+    ChunkCompressor(int level,
+                    size_t value_size,
+                    const std::array<hsize_t, 2>& chunk,
+                    const std::array<hsize_t, 2>& dims);
+
+    /**
+     * \brief Whether steps steps from first_step cover whole chunks, the last chunks of the
+     * dataset being padded
+     */
+    bool is_aligned(hsize_t first_step, hsize_t steps) const noexcept;
+    /**
+     * \brief Compress the chunks of steps steps of every element from first_step on the threads
+     * of pool, and write them in order. The steps must be aligned.
+     * \return false if a chunk failed to be compressed or written
+     */
+    bool write(hid_t dataset,
+               const void* buffer,
+               hsize_t first_step,
+               hsize_t steps,
+               ThreadPool& pool) const;
+
+    /**
+     * \brief Group the i-th bytes of the values together, as the HDF5 shuffle filter does
+     */
+    static void shuffle(const uint8_t* values,
+                        size_t size,
+                        size_t value_size,
+                        uint8_t* bytes) noexcept;
+
+  private:
+    /**
+     * \brief Shuffle and deflate the chunk starting at the given step and element of buffer,
+     * padding it with zeros past the end of the dataset
+     * \return the compressed chunk, empty if zlib failed
+     */
+    std::vector<uint8_t> compress_chunk(const uint8_t* buffer,
+                                        hsize_t steps,
+                                        hsize_t step,
+                                        hsize_t element,
+                                        std::vector<uint8_t>& values,
+                                        std::vector<uint8_t>& bytes) const;
+
+    int level_;
+    size_t value_size_;
+    std::array<hsize_t, 2> chunk_;
+    std::array<hsize_t, 2> dims_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
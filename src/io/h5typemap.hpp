@@ -35,6 +35,10 @@ hid_t inline get_h5_type(__attribute__((unused)) char v) {
     return H5T_NATIVE_CHAR;
 }
 template <>
+hid_t inline get_h5_type(__attribute__((unused)) signed char v) {
+    return H5T_NATIVE_SCHAR;
+}
+template <>
 hid_t inline get_h5_type(__attribute__((unused)) unsigned char v) {
     return H5T_NATIVE_UCHAR;
 }
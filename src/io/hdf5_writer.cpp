@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <tuple>
 
@@ -8,6 +9,41 @@
 namespace bbp {
 namespace sonata {
 
+namespace {
+
+// Type of the values of the report data in the file, independent of the platform, to be closed
+hid_t create_file_type(float) {
+    return H5Tcopy(H5T_IEEE_F32LE);
+}
+hid_t create_file_type(double) {
+    return H5Tcopy(H5T_IEEE_F64LE);
+}
+hid_t create_file_type(float16) {
+    // HDF5 has no predefined half type, defined as numpy and h5py do
+    hid_t type = H5Tcopy(H5T_IEEE_F32LE);
+    H5Tset_fields(type, 15, 10, 5, 0, 10);
+    H5Tset_size(type, 2);
+    H5Tset_ebias(type, 15);
+    return type;
+}
+hid_t create_file_type(int16_t) {
+    return H5Tcopy(H5T_STD_I16LE);
+}
+hid_t create_file_type(int8_t) {
+    return H5Tcopy(H5T_STD_I8LE);
+}
+
+template <typename T>
+hid_t get_memory_type(T value, hid_t) {
+    return h5typemap::get_h5_type(value);
+}
+// The halves are kept as they are stored
+hid_t get_memory_type(float16, hid_t file_type) {
+    return file_type;
+}
+
+}  // namespace
+
 template void HDF5Writer::write<uint32_t>(const std::string& dataset_name,
                                           const std::vector<uint32_t>& buffer);
 template void HDF5Writer::write<uint64_t>(const std::string& dataset_name,
@@ -16,6 +52,12 @@ template void HDF5Writer::write<float>(const std::string& dataset_name,
                                        const std::vector<float>& buffer);
 template void HDF5Writer::write<double>(const std::string& dataset_name,
                                         const std::vector<double>& buffer);
+template void HDF5Writer::write<uint32_t>(const std::string& dataset_name,
+                                          const std::vector<uint32_t>& buffer,
+                                          const DatasetExtent& extent);
+template void HDF5Writer::write<uint64_t>(const std::string& dataset_name,
+                                          const std::vector<uint64_t>& buffer,
+                                          const DatasetExtent& extent);
 
 HDF5Writer::HDF5Writer(const std::string& report_name, hid_t file_handler)
     : report_name_(report_name)
@@ -66,6 +108,56 @@ void HDF5Writer::configure_attribute(const std::string& dataset_name,
     H5Dclose(dataset_id);
 }
 
+void HDF5Writer::configure_attribute(const std::string& dataset_name,
+                                     const std::string& attribute_name,
+                                     double attribute_value) {
+    logger->trace("Configuring attribute '{}' for group name '{}' with value {}",
+                  attribute_name,
+                  dataset_name,
+                  attribute_value);
+    hid_t dataset_id = H5Dopen(file_, dataset_name.data(), H5P_DEFAULT);
+    hid_t attr_space = H5Screate(H5S_SCALAR);
+    hid_t attr_id = H5Acreate2(dataset_id,
+                               attribute_name.data(),
+                               H5T_IEEE_F64LE,
+                               attr_space,
+                               H5P_DEFAULT,
+                               H5P_DEFAULT);
+    H5Awrite(attr_id, H5T_NATIVE_DOUBLE, &attribute_value);
+
+    H5Aclose(attr_id);
+    H5Sclose(attr_space);
+    H5Dclose(dataset_id);
+}
+
+template <typename T>
+void HDF5Writer::configure_value_attribute(const std::string& dataset_name,
+                                           const std::string& attribute_name,
+                                           T attribute_value) {
+    logger->trace("Configuring attribute '{}' for group name '{}' with value {}",
+                  attribute_name,
+                  dataset_name,
+                  attribute_value);
+    hid_t dataset_id = H5Dopen(file_, dataset_name.data(), H5P_DEFAULT);
+    hid_t attr_space = H5Screate(H5S_SCALAR);
+    hid_t file_type = create_file_type(attribute_value);
+    hid_t attr_id = H5Acreate2(
+        dataset_id, attribute_name.data(), file_type, attr_space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr_id, get_memory_type(attribute_value, file_type), &attribute_value);
+
+    H5Aclose(attr_id);
+    H5Tclose(file_type);
+    H5Sclose(attr_space);
+    H5Dclose(dataset_id);
+}
+
+template void HDF5Writer::configure_value_attribute<int16_t>(const std::string& dataset_name,
+                                                             const std::string& attribute_name,
+                                                             int16_t attribute_value);
+template void HDF5Writer::configure_value_attribute<int8_t>(const std::string& dataset_name,
+                                                            const std::string& attribute_name,
+                                                            int8_t attribute_value);
+
 void HDF5Writer::configure_enum_attribute(const std::string& group_name,
                                           const std::string& attribute_name,
                                           const std::string& attribute_value) {
@@ -83,39 +175,102 @@ void HDF5Writer::configure_enum_attribute(const std::string& group_name,
     H5Gclose(group_id);
 }
 
+template <typename T>
 void HDF5Writer::configure_dataset(const std::string& dataset_name,
                                    uint32_t total_steps,
-                                   uint32_t total_elements) {
-    std::array<hsize_t, 2> dims = {total_steps,
-                                   Implementation::get_global_dims(report_name_, total_elements)};
+                                   const DatasetExtent& elements,
+                                   const Compression& compression) {
+    global_elements_ = elements.global_size;
+    std::array<hsize_t, 2> dims = {total_steps, global_elements_};
     hid_t data_space = H5Screate_simple(2, dims.data(), nullptr);
+    hid_t create_list = H5Pcreate(H5P_DATASET_CREATE);
+    // Chunks can't be empty nor larger than a fixed-size dataset
+    if (compression.is_chunked() && total_steps > 0 && global_elements_ > 0) {
+        std::array<hsize_t, 2> chunk = {
+            std::min<hsize_t>(std::max(compression.chunk_steps, 1u), total_steps),
+            std::min<hsize_t>(std::max(compression.chunk_elements, 1u), global_elements_)};
+        H5Pset_chunk(create_list, 2, chunk.data());
+        // Every value gets written, so don't fill the chunks beforehand
+        H5Pset_fill_time(create_list, H5D_FILL_TIME_NEVER);
+        if (compression.level > 0) {
+#if defined(SONATA_REPORT_HAVE_MPI) && !H5_VERSION_GE(1, 10, 2)
+            if (SonataReport::rank_ == 0) {
+                logger->warn("Parallel HDF5 {}.{}.{} can't write filtered datasets, writing {} "
+                             "uncompressed",
+                             H5_VERS_MAJOR,
+                             H5_VERS_MINOR,
+                             H5_VERS_RELEASE,
+                             dataset_name);
+            }
+#else
+            H5Pset_shuffle(create_list);
+            H5Pset_deflate(create_list, static_cast<unsigned>(compression.level));
+#endif
+            if (compression.direct_chunk_write) {
+#ifdef SONATA_REPORT_HAVE_DIRECT_CHUNK_WRITE
+                chunk_compressor_ =
+                    std::make_unique<ChunkCompressor>(compression.level, sizeof(T), chunk, dims);
+#else
+                if (SonataReport::rank_ == 0) {
+                    logger->warn("Direct chunk writes need a serial build with zlib and HDF5 "
+                                 "1.10.3, compressing {} through the HDF5 filters",
+                                 dataset_name);
+                }
+#endif
+            }
+        }
+        if (SonataReport::rank_ == 0) {
+            logger->debug("Dataset {} in chunks of {} x {}, compression level {}",
+                          dataset_name,
+                          chunk[0],
+                          chunk[1],
+                          compression.level);
+        }
+    }
+    value_type_ = create_file_type(T());
     dataset_ = H5Dcreate(file_,
                          dataset_name.c_str(),
-                         H5T_IEEE_F32LE,
+                         value_type_,
                          data_space,
                          H5P_DEFAULT,
-                         H5P_DEFAULT,
+                         create_list,
                          H5P_DEFAULT);
 
-    // Caculate the offset of each rank
-    offset_[1] = Implementation::get_offset(report_name_, total_elements);
+    offset_[1] = elements.offset;
+    H5Pclose(create_list);
     H5Sclose(data_space);
 }
 
-void HDF5Writer::write_2D(const std::vector<float>& buffer,
-                          uint32_t steps_to_write,
-                          uint32_t total_elements) {
-    hsize_t dims = buffer.size();
-    hsize_t global_dims = Implementation::get_global_dims(report_name_, dims);
-
-    if (global_dims > 0) {
+template <typename T>
+void HDF5Writer::write_2D(const T* buffer, uint32_t steps_to_write, uint32_t total_elements) {
+#ifdef SONATA_REPORT_HAVE_DIRECT_CHUNK_WRITE
+    if (chunk_compressor_ && total_elements == global_elements_ &&
+        chunk_compressor_->is_aligned(offset_[0], steps_to_write)) {
+        if (chunk_compressor_->write(dataset_,
+                                     buffer,
+                                     offset_[0],
+                                     steps_to_write,
+                                     SonataReport::get_compression_pool())) {
+            offset_[0] += steps_to_write;
+            return;
+        }
+        logger->warn("Direct chunk write failed in report {}, writing through the HDF5 filters",
+                     report_name_);
+    }
+#endif
+    if (global_elements_ > 0) {
         std::array<hsize_t, 2> count = {steps_to_write, total_elements};
         hid_t memspace = H5Screate_simple(2, count.data(), nullptr);
         hid_t filespace = H5Dget_space(dataset_);
 
         H5Sselect_hyperslab(
             filespace, H5S_SELECT_SET, offset_.data(), nullptr, count.data(), nullptr);
-        H5Dwrite(dataset_, H5T_NATIVE_FLOAT, memspace, filespace, collective_list_, buffer.data());
+        H5Dwrite(dataset_,
+                 get_memory_type(T(), value_type_),
+                 memspace,
+                 filespace,
+                 collective_list_,
+                 buffer);
 
         H5Sclose(filespace);
         H5Sclose(memspace);
@@ -123,16 +278,62 @@ void HDF5Writer::write_2D(const std::vector<float>& buffer,
     offset_[0] += steps_to_write;
 }
 
+template void HDF5Writer::configure_dataset<float>(const std::string& dataset_name,
+                                                  uint32_t total_steps,
+                                                  const DatasetExtent& elements,
+                                                  const Compression& compression);
+template void HDF5Writer::configure_dataset<double>(const std::string& dataset_name,
+                                                   uint32_t total_steps,
+                                                   const DatasetExtent& elements,
+                                                   const Compression& compression);
+template void HDF5Writer::configure_dataset<float16>(const std::string& dataset_name,
+                                                    uint32_t total_steps,
+                                                    const DatasetExtent& elements,
+                                                    const Compression& compression);
+template void HDF5Writer::configure_dataset<int16_t>(const std::string& dataset_name,
+                                                    uint32_t total_steps,
+                                                    const DatasetExtent& elements,
+                                                    const Compression& compression);
+template void HDF5Writer::configure_dataset<int8_t>(const std::string& dataset_name,
+                                                   uint32_t total_steps,
+                                                   const DatasetExtent& elements,
+                                                   const Compression& compression);
+template void HDF5Writer::write_2D<float>(const float* buffer,
+                                         uint32_t steps_to_write,
+                                         uint32_t total_elements);
+template void HDF5Writer::write_2D<double>(const double* buffer,
+                                          uint32_t steps_to_write,
+                                          uint32_t total_elements);
+template void HDF5Writer::write_2D<float16>(const float16* buffer,
+                                           uint32_t steps_to_write,
+                                           uint32_t total_elements);
+template void HDF5Writer::write_2D<int16_t>(const int16_t* buffer,
+                                           uint32_t steps_to_write,
+                                           uint32_t total_elements);
+template void HDF5Writer::write_2D<int8_t>(const int8_t* buffer,
+                                          uint32_t steps_to_write,
+                                          uint32_t total_elements);
+
 template <typename T>
 void HDF5Writer::write(const std::string& dataset_name, const std::vector<T>& buffer) {
+    DatasetExtent extent;
+    extent.global_size = Implementation::get_global_dims(report_name_, buffer.size());
+    extent.offset = Implementation::get_offset(report_name_, buffer.size());
+    write(dataset_name, buffer, extent);
+}
+
+template <typename T>
+void HDF5Writer::write(const std::string& dataset_name,
+                       const std::vector<T>& buffer,
+                       const DatasetExtent& extent) {
     if (SonataReport::rank_ == 0) {
         logger->debug("WRITING dataset {} in report {}", dataset_name, report_name_);
     }
     hid_t type = h5typemap::get_h5_type(T(0));
 
     hsize_t dims = buffer.size();
-    hsize_t global_dims = Implementation::get_global_dims(report_name_, dims);
-    hsize_t offset = Implementation::get_offset(report_name_, dims);
+    hsize_t global_dims = extent.global_size;
+    hsize_t offset = extent.offset;
 
     hid_t data_space = H5Screate_simple(1, &global_dims, nullptr);
     hid_t data_set = H5Dcreate(
@@ -173,6 +374,10 @@ void HDF5Writer::close() {
         H5Dclose(dataset_);
         dataset_ = 0;
     }
+    if (value_type_) {
+        H5Tclose(value_type_);
+        value_type_ = 0;
+    }
     if (spikes_attr_type_) {
         H5Tclose(spikes_attr_type_);
         spikes_attr_type_ = 0;
@@ -2,13 +2,36 @@
 #include <array>
 #include <fstream>
 #include <hdf5.h>
+#include <memory>
 #include <vector>
 
+#include "../data/storage.h"
+#include "chunk_compressor.h"
 #include "h5typemap.hpp"
+#include "population_layout.h"
 
 namespace bbp {
 namespace sonata {
 
+/**
+ * \brief Chunk shape and filters of the data of a report, written contiguously unless a
+ * compression level or a chunk size is set
+ */
+struct Compression {
+    // Deflate level from 1 to 9 after shuffling the bytes of the values, 0 for no filter
+    int level = 0;
+    // Steps and elements of a chunk, 0 for the default
+    uint32_t chunk_steps = 0;
+    uint32_t chunk_elements = 0;
+    // Compress the chunks on the compression threads and write them with H5Dwrite_chunk instead
+    // of going through the HDF5 filters, when supported and whole chunks are written
+    bool direct_chunk_write = false;
+
+    bool is_chunked() const noexcept {
+        return level > 0 || chunk_steps > 0 || chunk_elements > 0;
+    }
+};
+
 class HDF5Writer
 {
   public:
@@ -18,17 +41,39 @@ class HDF5Writer
     void configure_attribute(const std::string& dataset_name,
                              const std::string& attribute_name,
                              const std::string& attribute_value);
+    void configure_attribute(const std::string& dataset_name,
+                             const std::string& attribute_name,
+                             double attribute_value);
+    /**
+     * \brief Attribute stored with the type of the values of configure_dataset<T>, int16_t or
+     * int8_t
+     */
+    template <typename T>
+    void configure_value_attribute(const std::string& dataset_name,
+                                   const std::string& attribute_name,
+                                   T attribute_value);
     void configure_enum_attribute(const std::string& group_name,
                                   const std::string& attribute_name,
                                   const std::string& attribute_value);
+    /**
+     * \brief Create the 2D dataset written by write_2D, chunked and compressed as given once the
+     * chunk sizes are resolved, chunks being clamped to the dataset. Its values are of type T,
+     * any type of visit_storage_type, stored little endian.
+     */
+    template <typename T>
     void configure_dataset(const std::string& dataset_name,
                            uint32_t total_steps,
-                           uint32_t total_elements);
-    void write_2D(const std::vector<float>& buffer,
-                  uint32_t steps_to_write,
-                  uint32_t total_elements);
+                           const DatasetExtent& elements,
+                           const Compression& compression = {});
+    template <typename T>
+    void write_2D(const T* buffer, uint32_t steps_to_write, uint32_t total_elements);
     template <typename T>
     void write(const std::string& name, const std::vector<T>& buffer);
+    /**
+     * \brief Write buffer at the given part of a 1D dataset, without any other collective
+     */
+    template <typename T>
+    void write(const std::string& name, const std::vector<T>& buffer, const DatasetExtent& extent);
     void write_time(const std::string& dataset_name, const std::array<double, 3>& buffer);
     void close();
 
@@ -40,7 +85,11 @@ class HDF5Writer
     hid_t collective_list_ = 0;
     hid_t independent_list_ = 0;
     hid_t spikes_attr_type_ = 0;
+    // Type of the values of the 2D dataset in the file
+    hid_t value_type_ = 0;
+    hsize_t global_elements_ = 0;
     std::array<hsize_t, 2> offset_ = {0, 0};
+    std::unique_ptr<ChunkCompressor> chunk_compressor_;
 };
 
 }  // namespace sonata
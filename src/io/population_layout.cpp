@@ -0,0 +1,61 @@
+#include <algorithm>
+
+#include "population_layout.h"
+
+namespace bbp {
+namespace sonata {
+
+constexpr size_t PopulationLayout::num_counts;
+
+PopulationLayout::PopulationLayout(const std::vector<uint64_t>& counts, int rank) {
+    const int num_ranks = static_cast<int>(counts.size() / num_counts);
+    int last_writer = -1;
+    uint64_t max_steps_to_write = UINT32_MAX;
+    for (int r = 0; r < num_ranks; ++r) {
+        if (counts[r * num_counts] > 0) {
+            last_writer = r;
+        }
+        max_steps_to_write = std::min(max_steps_to_write, counts[r * num_counts + 2]);
+    }
+    is_last_writer_ = rank == last_writer;
+    max_steps_to_write_ = static_cast<uint32_t>(max_steps_to_write);
+
+    for (int r = 0; r < num_ranks; ++r) {
+        const uint64_t elements = counts[r * num_counts];
+        const uint64_t nodes = counts[r * num_counts + 1];
+        const uint64_t index_pointers = nodes + (r == last_writer ? 1 : 0);
+        if (r < rank) {
+            elements_.offset += elements;
+            nodes_.offset += nodes;
+            index_pointers_.offset += index_pointers;
+        }
+        elements_.global_size += elements;
+        max_rank_elements_ = std::max(max_rank_elements_, elements);
+        nodes_.global_size += nodes;
+        index_pointers_.global_size += index_pointers;
+    }
+}
+
+std::vector<PopulationLayout> PopulationLayout::from_counts(const std::vector<uint64_t>& counts,
+                                                           size_t num_populations,
+                                                           int rank) {
+    std::vector<PopulationLayout> layouts;
+    if (num_populations == 0) {
+        return layouts;
+    }
+    const size_t rank_size = num_populations * num_counts;
+    const size_t num_ranks = counts.size() / rank_size;
+    std::vector<uint64_t> population_counts(num_ranks * num_counts);
+    layouts.reserve(num_populations);
+    for (size_t population = 0; population < num_populations; ++population) {
+        for (size_t r = 0; r < num_ranks; ++r) {
+            const auto first = counts.begin() + r * rank_size + population * num_counts;
+            std::copy(first, first + num_counts, population_counts.begin() + r * num_counts);
+        }
+        layouts.emplace_back(population_counts, rank);
+    }
+    return layouts;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <hdf5.h>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Part of a dataset written by a rank
+ */
+struct DatasetExtent {
+    hsize_t offset = 0;
+    hsize_t global_size = 0;
+};
+
+/**
+ * \brief Sizes of a population on every rank of its report, exchanged once when the population is
+ * prepared so that writing it needs no collective other than the writes themselves
+ */
+class PopulationLayout
+{
+  public:
+    // Counts given by every rank: elements, nodes and steps fitting in its buffer
+    static constexpr size_t num_counts = 3;
+
+    PopulationLayout() = default;
+    /**
+     * \param counts the num_counts counts of every rank of the report, in rank order
+     * \param rank position of this rank in the report
+     */
+    PopulationLayout(const std::vector<uint64_t>& counts, int rank);
+
+    /**
+     * \brief Layouts of several populations exchanged together
+     * \param counts the num_counts counts of each of the num_populations populations of every
+     * rank, in rank order
+     */
+    static std::vector<PopulationLayout> from_counts(const std::vector<uint64_t>& counts,
+                                                     size_t num_populations,
+                                                     int rank);
+
+    const DatasetExtent& get_elements() const noexcept {
+        return elements_;
+    }
+    const DatasetExtent& get_nodes() const noexcept {
+        return nodes_;
+    }
+    /**
+     * \brief The last rank with elements writes the closing index pointer
+     */
+    const DatasetExtent& get_index_pointers() const noexcept {
+        return index_pointers_;
+    }
+    /**
+     * \brief Largest number of elements of the population on a single rank
+     */
+    uint64_t get_max_rank_elements() const noexcept {
+        return max_rank_elements_;
+    }
+    bool is_last_writer() const noexcept {
+        return is_last_writer_;
+    }
+    uint32_t get_max_steps_to_write() const noexcept {
+        return max_steps_to_write_;
+    }
+
+  private:
+    DatasetExtent elements_;
+    DatasetExtent nodes_;
+    DatasetExtent index_pointers_;
+    uint64_t max_rank_elements_ = 0;
+    bool is_last_writer_ = false;
+    uint32_t max_steps_to_write_ = 0;
+};
+
+}  // namespace sonata
+}  // namespace bbp
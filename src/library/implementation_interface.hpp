@@ -8,7 +8,9 @@
 #include <vector>
 
 #include "../utils/imeutil.h"
+#include "../utils/rank_sets.h"
 #include "../utils/logger.h"
+#include "../utils/spike_sort.h"
 #include "sonatareport.h"
 
 #ifdef SONATA_REPORT_HAVE_MPI
@@ -29,15 +31,14 @@ struct Implementation {
     static void close() {
         TImpl::close();
     }
-    static void add_communicator(const std::string& comm_name) {
-        return TImpl::add_communicator(comm_name);
+    static void add_communicators(const std::vector<uint32_t>& local_report_ids) {
+        TImpl::add_communicators(local_report_ids);
     }
-    static std::vector<std::string> sync_reports(const std::vector<std::string>& local_reports) {
-        return TImpl::sync_reports(local_reports);
+    static std::vector<std::string> sync_names(const std::vector<std::string>& local_names) {
+        return TImpl::sync_names(local_names);
     }
-    static std::vector<std::string> sync_populations(
-        const std::string& comm_name, const std::vector<std::string>& local_populations) {
-        return TImpl::sync_populations(comm_name, local_populations);
+    static void reduce_bitmap(std::vector<uint64_t>& bitmap) {
+        TImpl::reduce_bitmap(bitmap);
     }
     static hid_t prepare_write(const std::string& report_name) {
         return TImpl::prepare_write(report_name);
@@ -48,14 +49,21 @@ struct Implementation {
     static hsize_t get_offset(const std::string& report_name, hsize_t value) {
         return TImpl::get_offset(report_name, value);
     }
-    static int get_last_rank(const std::string& report_name, int value) {
-        return TImpl::get_last_rank(report_name, value);
+    static int get_rank(const std::string& report_name) {
+        return TImpl::get_rank(report_name);
     }
     static hsize_t get_global_dims(const std::string& report_name, hsize_t value) {
         return TImpl::get_global_dims(report_name, value);
     }
-    static uint32_t get_max_steps_to_write(const std::string& report_name, uint32_t value) {
-        return TImpl::get_max_steps_to_write(report_name, value);
+    static std::vector<uint64_t> gather_counts(const std::string& report_name,
+                                               const std::vector<uint64_t>& counts) {
+        return TImpl::gather_counts(report_name, counts);
+    }
+    static std::vector<uint64_t> gather_report_counts(const std::vector<uint64_t>& counts) {
+        return TImpl::gather_report_counts(counts);
+    }
+    static int get_report_rank() {
+        return TImpl::get_report_rank();
     }
     static void sort_spikes(std::vector<double>& spikevec_time,
                             std::vector<uint64_t>& spikevec_gid,
@@ -64,42 +72,6 @@ struct Implementation {
     }
 };
 
-static void local_spikevec_sort(std::vector<double>& isvect,
-                                std::vector<uint64_t>& isvecg,
-                                std::vector<double>& osvect,
-                                std::vector<uint64_t>& osvecg,
-                                const std::string& order_by) {
-    osvect.resize(isvect.size());
-    osvecg.resize(isvecg.size());
-    // first build a permutation vector
-    std::vector<uint64_t> perm(isvect.size());
-    std::iota(perm.begin(), perm.end(), 0);
-
-    if (order_by == "by_id") {
-        // sort by time
-        std::stable_sort(perm.begin(), perm.end(), [&](uint64_t i, uint64_t j) {
-            return isvect[i] < isvect[j];
-        });
-        // then sort by gid
-        std::stable_sort(perm.begin(), perm.end(), [&](uint64_t i, uint64_t j) {
-            return isvecg[i] < isvecg[j];
-        });
-    } else if (order_by == "by_time") {
-        // sort by gid (second predicate first)
-        std::stable_sort(perm.begin(), perm.end(), [&](uint64_t i, uint64_t j) {
-            return isvecg[i] < isvecg[j];
-        });
-        // then sort by time
-        std::stable_sort(perm.begin(), perm.end(), [&](uint64_t i, uint64_t j) {
-            return isvect[i] < isvect[j];
-        });
-    }
-
-    // now apply permutation to time and gid output vectors
-    std::transform(perm.begin(), perm.end(), osvect.begin(), [&](uint64_t i) { return isvect[i]; });
-    std::transform(perm.begin(), perm.end(), osvecg.begin(), [&](uint64_t i) { return isvecg[i]; });
-}
-
 static std::string add_extension(const std::string& report_name) {
     std::string new_name = report_name;
     // Add h5 suffix if name doesn't have it
@@ -135,52 +107,35 @@ static std::vector<std::string> sync_strings(const MPI_Comm comm,
     auto buffer = serialize(strings);
     auto buffer_size = static_cast<int>(buffer.size());
 
-    int nranks, local_rank;
-    MPI_Comm_rank(comm, &local_rank);
+    int nranks;
     MPI_Comm_size(comm, &nranks);
-    std::vector<int> counts((local_rank == 0) ? nranks : 0);
-    std::vector<int> displs((local_rank == 0) ? nranks : 0);
-
-    MPI_Gather(&buffer_size, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
-    if (local_rank == 0) {
-        std::partial_sum(counts.begin(), counts.end(), displs.begin());
-        displs.insert(displs.begin(), 0);  // To begin with offset=0
-
-        const auto buffer_sizes = std::accumulate(counts.begin(), counts.end(), 0);
-        buffer.resize(buffer_sizes);
-    }
-
-    auto send_buffer_ptr = (local_rank == 0) ? MPI_IN_PLACE : buffer.data();
-    MPI_Gatherv(send_buffer_ptr,
-                buffer_size,
-                MPI_CHAR,
-                buffer.data(),
-                counts.data(),
-                displs.data(),
-                MPI_CHAR,
-                0,
-                comm);
-    if (local_rank == 0) {
-        const auto buffer_str = deserialize(buffer);
-        // Eliminate duplicated populations
-        std::set<std::string> buffer_set(buffer_str.begin(), buffer_str.end());
-
-        buffer = serialize(std::vector<std::string>(buffer_set.begin(), buffer_set.end()));
-        buffer_size = static_cast<int>(buffer.size());
-    }
-
-    MPI_Bcast(&buffer_size, 1, MPI_INT, 0, comm);
-    buffer.resize(buffer_size);
-    MPI_Bcast(buffer.data(), buffer_size, MPI_CHAR, 0, comm);
-
-    // Return the vector of synced strings
-    return deserialize(buffer);
+    std::vector<int> counts(nranks);
+    std::vector<int> displs(nranks + 1);
+
+    // Every rank gets the strings of all the others, instead of going through rank 0
+    MPI_Allgather(&buffer_size, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+    std::partial_sum(counts.begin(), counts.end(), displs.begin() + 1);
+    std::vector<char> all_buffers(displs.back());
+    MPI_Allgatherv(buffer.data(),
+                   buffer_size,
+                   MPI_CHAR,
+                   all_buffers.data(),
+                   counts.data(),
+                   displs.data(),
+                   MPI_CHAR,
+                   comm);
+
+    // Eliminate duplicated strings
+    const auto all_strings = deserialize(all_buffers);
+    std::set<std::string> unique_strings(all_strings.begin(), all_strings.end());
+    return std::vector<std::string>(unique_strings.begin(), unique_strings.end());
 }
 
 static MPI_Comm get_Comm(const std::string& comm_name) {
-    if (SonataReport::communicators_.find(comm_name) != SonataReport::communicators_.end()) {
+    const uint32_t report_id = SonataReport::report_ids_.find(comm_name);
+    if (report_id < SonataReport::communicators_.size()) {
         // Found
-        return SonataReport::communicators_[comm_name];
+        return SonataReport::communicators_[report_id];
     }
     return MPI_COMM_WORLD;
 }
@@ -198,33 +153,81 @@ struct ParallelImplementation {
         int num_reports = report_names.size();
         MPI_Comm_split(MPI_COMM_WORLD, num_reports == 0, 0, &SonataReport::has_nodes_);
 
-        std::vector<std::string> global_report_names = sync_reports(report_names);
-        for (const auto& report : global_report_names) {
-            bool has_report = std::find(report_names.begin(), report_names.end(), report) !=
-                              report_names.end();
-            add_communicator(report, has_report);
-        }
-
         return global_rank;
     };
 
     static void close(){};
 
-    static void add_communicator(const std::string& comm_name, bool has_report = true) {
-        if (SonataReport::communicators_.find(comm_name) == SonataReport::communicators_.end()) {
-            MPI_Comm_split(SonataReport::has_nodes_,
-                           has_report,
-                           0,
-                           &SonataReport::communicators_[comm_name]);
+    /**
+     * \brief Create the communicators of the interned reports without one yet, a single one for
+     * the reports with the same ranks. Only the ranks of a report take part in creating its
+     * communicator, the others storing MPI_COMM_NULL for it.
+     */
+    static void add_communicators(const std::vector<uint32_t>& local_report_ids) {
+        // The reports without communicator are the last ones interned
+        const size_t first_new = SonataReport::communicators_.size();
+        const size_t num_new = SonataReport::report_ids_.size() - first_new;
+
+        // Bitmap of the new reports of every rank, in one exchange
+        const size_t num_words = RankSets::get_num_words(num_new);
+        std::vector<uint64_t> bitmap(num_words);
+        for (uint32_t report_id : local_report_ids) {
+            if (report_id >= first_new) {
+                RankSets::add_report(bitmap, report_id - first_new);
+            }
         }
-    };
-    static std::vector<std::string> sync_reports(const std::vector<std::string>& local_reports) {
-        return sync_strings(SonataReport::has_nodes_, local_reports);
+        int rank, size;
+        MPI_Comm_rank(SonataReport::has_nodes_, &rank);
+        MPI_Comm_size(SonataReport::has_nodes_, &size);
+        std::vector<uint64_t> bitmaps(num_words * size);
+        MPI_Allgather(bitmap.data(),
+                      static_cast<int>(num_words),
+                      MPI_UINT64_T,
+                      bitmaps.data(),
+                      static_cast<int>(num_words),
+                      MPI_UINT64_T,
+                      SonataReport::has_nodes_);
+        const RankSets rank_sets(bitmaps, num_new);
+
+        MPI_Group has_nodes_group;
+        MPI_Comm_group(SonataReport::has_nodes_, &has_nodes_group);
+        SonataReport::communicators_.resize(first_new + num_new, MPI_COMM_NULL);
+        size_t num_communicators = 0;
+        for (size_t report = 0; report < num_new; ++report) {
+            MPI_Comm& comm = SonataReport::communicators_[first_new + report];
+            const size_t leader = rank_sets.get_leader(report);
+            if (leader != report) {
+                comm = SonataReport::communicators_[first_new + leader];
+            } else if (rank_sets.has_rank(report, rank)) {
+                // Collective over the ranks of the report only, which all see the same leaders
+                const std::vector<int> ranks = rank_sets.get_ranks(report);
+                MPI_Group group;
+                MPI_Group_incl(
+                    has_nodes_group, static_cast<int>(ranks.size()), ranks.data(), &group);
+                MPI_Comm_create_group(
+                    SonataReport::has_nodes_, group, static_cast<int>(report), &comm);
+                MPI_Group_free(&group);
+            }
+            num_communicators += leader == report;
+        }
+        MPI_Group_free(&has_nodes_group);
+        if (SonataReport::rank_ == 0 && num_new > 0) {
+            logger->debug("{} report(s) sharing {} communicator(s)", num_new, num_communicators);
+        }
+    }
+
+    // Sorted names of all the ranks with reports
+    static std::vector<std::string> sync_names(const std::vector<std::string>& local_names) {
+        return sync_strings(SonataReport::has_nodes_, local_names);
     };
 
-    static std::vector<std::string> sync_populations(
-        const std::string& comm_name, const std::vector<std::string>& local_populations) {
-        return sync_strings(get_Comm(comm_name), local_populations);
+    static void reduce_bitmap(std::vector<uint64_t>& bitmap) {
+        MPI_Allreduce(MPI_IN_PLACE,
+                      bitmap.data(),
+                      static_cast<int>(bitmap.size()),
+                      MPI_UINT64_T,
+                      MPI_BOR,
+                      SonataReport::has_nodes_);
     };
 
     static hid_t prepare_write(const std::string& report_name) {
@@ -264,10 +267,10 @@ struct ParallelImplementation {
         return offset;
     };
 
-    static int get_last_rank(const std::string& comm_name, int value) {
-        int last_rank = 0;
-        MPI_Allreduce(&value, &last_rank, 1, MPI_INT, MPI_MAX, get_Comm(comm_name));
-        return last_rank;
+    static int get_rank(const std::string& comm_name) {
+        int rank;
+        MPI_Comm_rank(get_Comm(comm_name), &rank);
+        return rank;
     }
 
     static hsize_t get_global_dims(const std::string& comm_name, hsize_t value) {
@@ -276,86 +279,120 @@ struct ParallelImplementation {
         return global_dims;
     };
 
-    static uint32_t get_max_steps_to_write(const std::string& comm_name, uint32_t value) {
-        uint32_t max_steps_to_write = value;
-        MPI_Allreduce(&value, &max_steps_to_write, 1, MPI_UNSIGNED, MPI_MIN, get_Comm(comm_name));
-        return max_steps_to_write;
+    static std::vector<uint64_t> gather_counts(const std::string& comm_name,
+                                               const std::vector<uint64_t>& counts) {
+        return gather_counts(get_Comm(comm_name), counts);
     };
 
+    static std::vector<uint64_t> gather_report_counts(const std::vector<uint64_t>& counts) {
+        return gather_counts(SonataReport::has_nodes_, counts);
+    };
+
+    static int get_report_rank() {
+        int rank;
+        MPI_Comm_rank(SonataReport::has_nodes_, &rank);
+        return rank;
+    }
+
+    static std::vector<uint64_t> gather_counts(MPI_Comm comm, const std::vector<uint64_t>& counts) {
+        int size;
+        MPI_Comm_size(comm, &size);
+        std::vector<uint64_t> all_counts(counts.size() * size);
+        MPI_Allgather(counts.data(),
+                      static_cast<int>(counts.size()),
+                      MPI_UINT64_T,
+                      all_counts.data(),
+                      static_cast<int>(counts.size()),
+                      MPI_UINT64_T,
+                      comm);
+        return all_counts;
+    };
+
+    /**
+     * \brief Sample sort of the spikes of every rank, each rank getting a balanced share of
+     * consecutive spikes in the given order, sorted. The splitters between the ranks are taken
+     * from keys sampled with the same stride on every rank, so that a burst of spikes at the same
+     * time is split as any other. Spikes in no order stay where they are.
+     */
     static void sort_spikes(std::vector<double>& spikevec_time,
                             std::vector<uint64_t>& spikevec_gid,
                             const std::string& order_by) {
-        double lmin_time = std::numeric_limits<double>::max();
-        double lmax_time = std::numeric_limits<double>::min();
-        if (!spikevec_time.empty()) {
-            lmin_time = *(std::min_element(spikevec_time.begin(), spikevec_time.end()));
-            lmax_time = *(std::max_element(spikevec_time.begin(), spikevec_time.end()));
+        if (order_by != "by_time" && order_by != "by_id") {
+            return;
         }
-
-        double min_time;
-        MPI_Allreduce(&lmin_time, &min_time, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-        double max_time;
-        MPI_Allreduce(&lmax_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
-
-        std::vector<double> inTime = spikevec_time;
-        std::vector<uint64_t> inGid = spikevec_gid;
-        local_spikevec_sort(inTime, inGid, spikevec_time, spikevec_gid, order_by);
-
+        const bool by_id = order_by == "by_id";
         int numprocs;
         MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
-        // allocate send and receive counts and displacements for MPI_Alltoallv
-        std::vector<int> snd_cnts(numprocs);
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+        // The keys are the only copy of the spikes until they are unpacked
+        std::vector<SpikeKey> keys = pack_spikes(spikevec_time, spikevec_gid, by_id);
+        std::vector<double>().swap(spikevec_time);
+        std::vector<uint64_t>().swap(spikevec_gid);
+        sort_spike_keys(keys);
+
+        MPI_Datatype key_type;
+        MPI_Type_contiguous(2, MPI_UINT64_T, &key_type);
+        MPI_Type_commit(&key_type);
+
+        uint64_t total_spikes = keys.size();
+        MPI_Allreduce(MPI_IN_PLACE, &total_spikes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        std::vector<SpikeKey> samples =
+            sample_spike_keys(keys, get_sample_stride(total_spikes, numprocs));
+
+        // The first rank selects the splitters from the samples of every rank
+        int local_samples = static_cast<int>(samples.size());
+        std::vector<int> sample_counts(numprocs);
+        MPI_Gather(
+            &local_samples, 1, MPI_INT, sample_counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+        std::vector<int> sample_dsps(numprocs);
+        std::partial_sum(sample_counts.begin(), sample_counts.end() - 1, sample_dsps.begin() + 1);
+        std::vector<SpikeKey> all_samples(
+            rank == 0 ? sample_dsps.back() + sample_counts.back() : 0);
+        MPI_Gatherv(samples.data(),
+                    local_samples,
+                    key_type,
+                    all_samples.data(),
+                    sample_counts.data(),
+                    sample_dsps.data(),
+                    key_type,
+                    0,
+                    MPI_COMM_WORLD);
+        std::vector<SpikeKey> splitters;
+        if (rank == 0) {
+            splitters = select_splitters(all_samples, numprocs);
+        }
+        int num_splitters = static_cast<int>(splitters.size());
+        MPI_Bcast(&num_splitters, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        splitters.resize(num_splitters);
+        MPI_Bcast(splitters.data(), num_splitters, key_type, 0, MPI_COMM_WORLD);
+
+        // The parts of the sorted keys are consecutive, so they are sent as they are
+        const std::vector<size_t> parts = count_parts(keys, splitters, numprocs);
+        std::vector<int> snd_cnts(parts.begin(), parts.end());
         std::vector<int> rcv_cnts(numprocs);
+        MPI_Alltoall(snd_cnts.data(), 1, MPI_INT, rcv_cnts.data(), 1, MPI_INT, MPI_COMM_WORLD);
         std::vector<int> snd_dsps(numprocs);
         std::vector<int> rcv_dsps(numprocs);
-
-        double bin_t = (max_time - min_time) / numprocs;
-
-        bin_t = bin_t ? bin_t : 1;
-        // first find number of spikes in each time window
-        for (const auto& st : spikevec_time) {
-            int idx = (int) (st - min_time) / bin_t;
-            snd_cnts[idx]++;
-        }
-
-        // now let each rank know how many spikes they will receive
-        // and get in turn all the buffer sizes to receive
-        MPI_Alltoall(&snd_cnts[0], 1, MPI_INT, &rcv_cnts[0], 1, MPI_INT, MPI_COMM_WORLD);
-        for (int i = 1; i < numprocs; i++) {
-            rcv_dsps[i] = rcv_dsps[i - 1] + rcv_cnts[i - 1];
-        }
-
-        for (int i = 1; i < numprocs; i++) {
-            snd_dsps[i] = snd_dsps[i - 1] + snd_cnts[i - 1];
-        }
-
-        const std::size_t new_sz = std::accumulate(rcv_cnts.begin(), rcv_cnts.end(), 0);
-
-        // prepare new sorted vectors
-        std::vector<double> svt_buf(new_sz, 0.0);
-        std::vector<uint64_t> svg_buf(new_sz, 0);
-
-        // now exchange data
-        MPI_Alltoallv(spikevec_time.data(),
-                      &snd_cnts[0],
-                      &snd_dsps[0],
-                      MPI_DOUBLE,
-                      svt_buf.data(),
-                      &rcv_cnts[0],
-                      &rcv_dsps[0],
-                      MPI_DOUBLE,
-                      MPI_COMM_WORLD);
-        MPI_Alltoallv(spikevec_gid.data(),
-                      &snd_cnts[0],
-                      &snd_dsps[0],
-                      MPI_UINT64_T,
-                      svg_buf.data(),
-                      &rcv_cnts[0],
-                      &rcv_dsps[0],
-                      MPI_UINT64_T,
+        std::partial_sum(snd_cnts.begin(), snd_cnts.end() - 1, snd_dsps.begin() + 1);
+        std::partial_sum(rcv_cnts.begin(), rcv_cnts.end() - 1, rcv_dsps.begin() + 1);
+
+        std::vector<SpikeKey> received(static_cast<size_t>(rcv_dsps.back()) + rcv_cnts.back());
+        MPI_Alltoallv(keys.data(),
+                      snd_cnts.data(),
+                      snd_dsps.data(),
+                      key_type,
+                      received.data(),
+                      rcv_cnts.data(),
+                      rcv_dsps.data(),
+                      key_type,
                       MPI_COMM_WORLD);
+        MPI_Type_free(&key_type);
+        std::vector<SpikeKey>().swap(keys);
 
-        local_spikevec_sort(svt_buf, svg_buf, spikevec_time, spikevec_gid, order_by);
+        sort_spike_keys(received);
+        unpack_spikes(received, by_id, spikevec_time, spikevec_gid);
     };
 };
 
@@ -367,14 +404,12 @@ struct SerialImplementation {
         return 0;
     };
     static void close(){};
-    static void add_communicator(const std::string& /*comm_nam*/){};
-    static std::vector<std::string> sync_reports(const std::vector<std::string>& local_reports) {
-        return local_reports;
-    };
-    static std::vector<std::string> sync_populations(
-        const std::string& /*comm_name*/, const std::vector<std::string>& local_populations) {
-        return local_populations;
+    static void add_communicators(const std::vector<uint32_t>& /*local_report_ids*/){};
+    static std::vector<std::string> sync_names(const std::vector<std::string>& local_names) {
+        std::set<std::string> unique_names(local_names.begin(), local_names.end());
+        return std::vector<std::string>(unique_names.begin(), unique_names.end());
     };
+    static void reduce_bitmap(std::vector<uint64_t>& /*bitmap*/){};
     static hid_t prepare_write(const std::string& report_name) {
         hid_t plist_id = H5Pcreate(H5P_FILE_ACCESS);
         std::string file_name = add_extension(report_name);
@@ -387,21 +422,26 @@ struct SerialImplementation {
     static hsize_t get_offset(const std::string& /*report_name*/, hsize_t /*value*/) {
         return 0;
     };
-    static int get_last_rank(const std::string& /*report_name*/, hsize_t /*value*/) {
+    static int get_rank(const std::string& /*report_name*/) {
         return 0;
     };
     static hsize_t get_global_dims(const std::string& /*report_name*/, hsize_t value) {
         return value;
     };
-    static uint32_t get_max_steps_to_write(const std::string& /*report_name*/, uint32_t value) {
-        return value;
+    static std::vector<uint64_t> gather_counts(const std::string& /*report_name*/,
+                                               const std::vector<uint64_t>& counts) {
+        return counts;
+    };
+    static std::vector<uint64_t> gather_report_counts(const std::vector<uint64_t>& counts) {
+        return counts;
+    };
+    static int get_report_rank() {
+        return 0;
     };
     static void sort_spikes(std::vector<double>& spikevec_time,
                             std::vector<uint64_t>& spikevec_gid,
                             const std::string& order_by) {
-        std::vector<double> times(spikevec_time);
-        std::vector<uint64_t> gids(spikevec_gid);
-        local_spikevec_sort(times, gids, spikevec_time, spikevec_gid, order_by);
+        bbp::sonata::sort_spikes(spikevec_time, spikevec_gid, order_by);
     };
 };
 
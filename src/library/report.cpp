@@ -15,13 +15,15 @@ constexpr uint64_t default_max_buffer_size = 4194304;
 
 Report::Report(
     const std::string& report_name, double tstart, double tend, double dt, const std::string& units)
-    : populations_(std::make_shared<populations_t>())
+    : arena_(std::make_shared<Arena>())
+    , populations_(std::make_shared<populations_t>())
     , report_name_(report_name)
     , tstart_(tstart)
     , tend_(tend)
     , dt_(dt)
     , units_(units)
     , max_buffer_size_(default_max_buffer_size)
+    , node_order_("by_id")
     , report_is_closed_(false) {
     // Calculate number of reporting steps, rounding the tstart value in case of save-restore
     tstart = round(tstart / dt) * dt;
@@ -31,54 +33,68 @@ Report::Report(
 void Report::add_node(const std::string& population_name,
                       uint64_t population_offset,
                       uint64_t node_id) {
-    if (population_exists(population_name)) {
-        if (node_exists(population_name, node_id)) {
-            throw std::runtime_error("Warning: attempted to add node " + std::to_string(node_id) +
-                                     " to the target multiple times on same node. Ignoring.");
-        }
-        std::shared_ptr<nodes_t> nodes = populations_->at(population_name);
-        nodes->emplace(node_id, std::make_shared<Node>(node_id));
-    } else {
-        // node is new insert it into the map
-        std::shared_ptr<nodes_t> nodes = std::make_shared<nodes_t>();
-        nodes->emplace(node_id, std::make_shared<Node>(node_id));
-        populations_->emplace(population_name, nodes);
+    add_nodes(population_name, population_offset, &node_id, 1);
+}
+
+void Report::add_nodes(const std::string& population_name,
+                       uint64_t population_offset,
+                       const uint64_t* node_ids,
+                       size_t num_nodes) {
+    auto population = populations_->find(population_name);
+    if (population == populations_->end()) {
+        // population is new insert it into the map
+        population = populations_->emplace(population_name, create_population()).first;
         population_offsets_.emplace(population_name, population_offset);
     }
+    population->second->add_nodes(node_ids, num_nodes);
+}
+
+void Report::add_elements(const std::string& population_name,
+                          const uint64_t* node_ids,
+                          size_t num_nodes,
+                          const uint64_t* offsets,
+                          const uint32_t* element_ids,
+                          double* const* element_values) {
+    populations_->at(population_name)
+        ->add_elements(node_ids, num_nodes, offsets, element_ids, element_values);
+}
+
+std::shared_ptr<NodeTable> Report::create_population() const {
+    return std::make_shared<NodeTable>(NodeTable::unlimited, arena_);
 }
 
 bool Report::node_exists(const std::string& population_name, uint64_t node_id) const {
-    std::shared_ptr<nodes_t> nodes = populations_->at(population_name);
-    return nodes->find(node_id) != nodes->end();
+    return populations_->at(population_name)->contains(node_id);
 }
 
 bool Report::population_exists(const std::string& population_name) const {
     return populations_->find(population_name) != populations_->end();
 }
 
-std::shared_ptr<Node> Report::get_node(const std::string& population_name, uint64_t node_id) const {
-    return populations_->at(population_name)->at(node_id);
+std::shared_ptr<NodeTable> Report::get_population(const std::string& population_name) const {
+    return populations_->at(population_name);
 }
 
-int Report::prepare_dataset() {
-    file_handler_ = Implementation::prepare_write(report_name_);
-
-    std::vector<std::string> local_populations;
+std::vector<std::string> Report::get_population_names() const {
+    std::vector<std::string> population_names;
     std::transform(begin(*populations_),
                    end(*populations_),
-                   back_inserter(local_populations),
+                   back_inserter(population_names),
                    [](auto const& pair) { return pair.first; });
+    return population_names;
+}
 
-    std::vector<std::string> global_populations =
-        Implementation::sync_populations(report_name_, local_populations);
-    for (const auto& population_name : global_populations) {
-        std::shared_ptr<nodes_t> nodes;
+void Report::create_populations(const std::vector<std::string>& population_names) {
+    file_handler_ = Implementation::prepare_write(report_name_);
+
+    for (const auto& population_name : population_names) {
+        std::shared_ptr<NodeTable> nodes;
         if (population_exists(population_name)) {
             nodes = populations_->at(population_name);
         } else {
             // Creating empty nodes for ranks without certain populations to participate in
             // collectives
-            nodes = std::make_shared<nodes_t>();
+            nodes = create_population();
         }
         sonata_populations_.push_back(
             std::make_unique<SonataData>(report_name_,
@@ -92,15 +108,39 @@ int Report::prepare_dataset() {
                                          units_,
                                          nodes,
                                          file_handler_));
-        sonata_populations_.back()->prepare_dataset();
+        sonata_populations_.back()->set_node_order(node_order_);
+        sonata_populations_.back()->set_compression(compression_);
+        sonata_populations_.back()->set_storage(storage_);
+        sonata_populations_.back()->set_sampling(sampling_);
+        sonata_populations_.back()->set_statistics(statistics_);
+        if (get_summation() != Summation::none) {
+            sonata_populations_.back()->set_summation(get_summation());
+        }
     }
-    return 0;
 }
 
-void Report::record_data(double step, const std::vector<uint64_t>& node_ids) {
+std::vector<uint64_t> Report::get_local_counts() const {
+    std::vector<uint64_t> counts;
+    counts.reserve(sonata_populations_.size() * PopulationLayout::num_counts);
+    for (const auto& sonata_data : sonata_populations_) {
+        const auto population_counts = sonata_data->get_local_counts();
+        counts.insert(counts.end(), population_counts.begin(), population_counts.end());
+    }
+    return counts;
+}
+
+void Report::prepare_populations(const std::vector<PopulationLayout>& layouts) {
+    for (size_t i = 0; i < sonata_populations_.size(); ++i) {
+        sonata_populations_[i]->prepare_dataset(layouts[i]);
+    }
+}
+
+void Report::record_data(double step, const int* node_ids, size_t num_nodes) {
     for (const auto& sonata_data : sonata_populations_) {
         if (sonata_data->is_due_to_report(step)) {
-            sonata_data->record_data(step, node_ids);
+            sonata_data->record_data(step, node_ids, num_nodes);
+        } else if (sonata_data->is_in_window(step)) {
+            sonata_data->accumulate(node_ids, num_nodes);
         }
     }
 }
@@ -109,6 +149,8 @@ void Report::record_data(double step) {
     for (const auto& sonata_data : sonata_populations_) {
         if (sonata_data->is_due_to_report(step)) {
             sonata_data->record_data(step);
+        } else if (sonata_data->is_in_window(step)) {
+            sonata_data->accumulate(step);
         }
     }
 }
@@ -121,10 +163,11 @@ void Report::check_and_flush(double timestep) {
 
 void Report::refresh_pointers(std::function<double*(double*)> refresh_function) {
     for (auto& population : *populations_) {
-        std::shared_ptr<nodes_t> nodes = population.second;
-        for (auto& kv : *nodes) {
-            kv.second->refresh_pointers(refresh_function);
-        }
+        population.second->refresh_pointers(refresh_function);
+    }
+    // The contiguous runs found by the gather plans depend on the element pointers
+    for (const auto& sonata_data : sonata_populations_) {
+        sonata_data->update_gather_plan();
     }
 }
 
@@ -135,6 +178,24 @@ void Report::flush(double time) {
     for (const auto& sonata_data : sonata_populations_) {
         // Write if there are any remaining steps to write
         sonata_data->write_data();
+    }
+    flush_end(time);
+}
+
+void Report::flush_begin(double time) {
+    if (SonataReport::rank_ == 0) {
+        logger->trace("Flush begin at t={} for report {}", time, report_name_);
+    }
+    for (const auto& sonata_data : sonata_populations_) {
+        sonata_data->write_data(true);
+    }
+}
+
+void Report::flush_end(double time) {
+    // The writer thread may still be writing the other populations and reports
+    SonataReport::wait_for_writer();
+    for (const auto& sonata_data : sonata_populations_) {
+        sonata_data->wait_for_writes();
         if (time - tend_ + dt_ / 2 > 1e-6) {
             sonata_data->close();
         }
@@ -153,5 +214,74 @@ void Report::set_max_buffer_size(size_t buffer_size) {
     max_buffer_size_ = buffer_size;
 }
 
+void Report::set_node_order(const std::string& node_order) {
+    if (node_order != "by_id" && node_order != "by_address") {
+        throw std::runtime_error("Node order " + node_order + " does not exist");
+    }
+    logger->trace("Setting node order of report {} to {}", report_name_, node_order);
+    node_order_ = node_order;
+}
+
+void Report::set_sampling(const std::string& sampling) {
+    if (sampling == "instantaneous") {
+        sampling_ = Sampling::instantaneous;
+    } else if (sampling == "mean") {
+        sampling_ = Sampling::mean;
+    } else if (sampling == "min") {
+        sampling_ = Sampling::min;
+    } else if (sampling == "max") {
+        sampling_ = Sampling::max;
+    } else {
+        throw std::runtime_error("Sampling " + sampling + " does not exist");
+    }
+    logger->trace("Setting sampling of report {} to {}", report_name_, sampling);
+}
+
+void Report::set_summation(const std::string& summation) {
+    throw std::runtime_error("Report " + report_name_ + " is not a summation report, summation " +
+                             summation + " can't be set");
+}
+
+void Report::set_statistics(const std::string& statistics) {
+    if (statistics == "none") {
+        statistics_ = Statistics::none;
+    } else if (statistics == "with_data") {
+        statistics_ = Statistics::with_data;
+    } else if (statistics == "without_data") {
+        statistics_ = Statistics::without_data;
+    } else {
+        throw std::runtime_error("Statistics " + statistics + " does not exist");
+    }
+    logger->trace("Setting statistics of report {} to {}", report_name_, statistics);
+}
+
+void Report::set_compression(const Compression& compression) {
+    if (compression.level < 0 || compression.level > 9) {
+        throw std::runtime_error("Compression level " + std::to_string(compression.level) +
+                                 " is not between 0 and 9");
+    }
+    logger->trace("Setting compression of report {} to level {} in chunks of {} x {}",
+                  report_name_,
+                  compression.level,
+                  compression.chunk_steps,
+                  compression.chunk_elements);
+    compression_ = compression;
+}
+
+void Report::set_storage(const Storage& storage) {
+    if (storage.is_quantized() && !(storage.scale > 0 && std::isfinite(storage.scale) &&
+                                    std::isfinite(storage.offset))) {
+        throw std::runtime_error("Quantization scale " + std::to_string(storage.scale) +
+                                 " and offset " + std::to_string(storage.offset) +
+                                 " are not valid");
+    }
+    logger->trace("Storing report {} as {} bytes per value with scale {} and offset {}",
+                  report_name_,
+                  get_value_size(storage.type),
+                  storage.scale,
+                  storage.offset);
+    storage_ = storage;
+}
+
 }  // namespace sonata
 }  // namespace bbp
@@ -3,7 +3,7 @@
 #include <memory>
 #include <string>
 
-#include "../data/node.h"
+#include "../data/node_table.h"
 #include "../data/sonata_data.h"
 
 namespace bbp {
@@ -27,31 +27,100 @@ class Report
     int get_num_steps() const noexcept {
         return num_steps_;
     }
+    std::vector<std::string> get_population_names() const;
     /**
-     * Allocates the buffers used to hold main
-     * report data.
-     *
-     * @return 0 on success, non zero on failure
+     * \brief Create the report file and the given populations, the ones of every rank of the
+     * report, without allocating their buffers yet
      */
-    int prepare_dataset();
+    void create_populations(const std::vector<std::string>& population_names);
+    /**
+     * \brief Counts of every population created on this rank, one population after the other
+     */
+    std::vector<uint64_t> get_local_counts() const;
+    /**
+     * \brief Allocate the buffers used to hold main report data and write the mappings, given
+     * the layouts of the populations exchanged with the other ranks
+     */
+    void prepare_populations(const std::vector<PopulationLayout>& layouts);
 
-    virtual void add_node(const std::string& population_name,
-                          uint64_t population_offset,
-                          uint64_t node_id);
+    void add_node(const std::string& population_name,
+                  uint64_t population_offset,
+                  uint64_t node_id);
+    /**
+     * \brief Add num_nodes nodes to a population with a single lookup of the population. Ids given
+     * in increasing order are appended in constant time each.
+     */
+    void add_nodes(const std::string& population_name,
+                   uint64_t population_offset,
+                   const uint64_t* node_ids,
+                   size_t num_nodes);
+    /**
+     * \brief Add the elements [offsets[i], offsets[i + 1]) of element_ids and element_values to
+     * the node node_ids[i], for every i < num_nodes
+     */
+    void add_elements(const std::string& population_name,
+                      const uint64_t* node_ids,
+                      size_t num_nodes,
+                      const uint64_t* offsets,
+                      const uint32_t* element_ids,
+                      double* const* element_values);
     bool node_exists(const std::string& population_name, uint64_t node_id) const;
     bool population_exists(const std::string& population_name) const;
-    std::shared_ptr<Node> get_node(const std::string& population_name, uint64_t node_id) const;
+    std::shared_ptr<NodeTable> get_population(const std::string& population_name) const;
     virtual size_t get_total_elements(const std::string& population_name) const = 0;
 
-    virtual void record_data(double step, const std::vector<uint64_t>& node_ids);
+    virtual void record_data(double step, const int* node_ids, size_t num_nodes);
     virtual void record_data(double step);
     virtual void check_and_flush(double timestep);
     virtual void flush(double time);
+    /**
+     * \brief Start writing the remaining steps in the background, flush_end waiting for them and
+     * closing the file as flush does
+     */
+    void flush_begin(double time);
+    void flush_end(double time);
     void refresh_pointers(std::function<double*(double*)> refresh_function);
     void set_max_buffer_size(size_t buffer_size);
+    void set_node_order(const std::string& node_order);
+    /**
+     * \brief Sampling of every population: "instantaneous" (default), "mean", "min" or "max"
+     */
+    void set_sampling(const std::string& sampling);
+    /**
+     * \brief Values summed by a summation report: "element" (default) or "node". Throws for the
+     * other reports.
+     */
+    virtual void set_summation(const std::string& summation);
+    /**
+     * \brief Statistics of every population: "none" (default), "with_data" or "without_data"
+     */
+    void set_statistics(const std::string& statistics);
+    /**
+     * \brief Chunks and filters of the data of every population, checked to be a deflate level
+     * between 0 and 9
+     */
+    void set_compression(const Compression& compression);
+    const Compression& get_compression() const noexcept {
+        return compression_;
+    }
+    /**
+     * \brief Type of the values of every population, checked to have a positive and finite scale
+     * if quantized
+     */
+    void set_storage(const Storage& storage);
+    const Storage& get_storage() const noexcept {
+        return storage_;
+    }
 
   protected:
-    using populations_t = std::map<std::string, std::shared_ptr<nodes_t>>;
+    virtual std::shared_ptr<NodeTable> create_population() const;
+    virtual Summation get_summation() const noexcept {
+        return Summation::none;
+    }
+
+    using populations_t = std::map<std::string, std::shared_ptr<NodeTable>>;
+    // Holds the node tables of every population once they are sealed
+    std::shared_ptr<Arena> arena_;
     std::shared_ptr<populations_t> populations_;
     std::map<std::string, uint64_t> population_offsets_;
     std::vector<std::shared_ptr<SonataData>> sonata_populations_;
@@ -64,6 +133,11 @@ class Report
     std::string units_;
     int num_steps_;
     size_t max_buffer_size_;
+    std::string node_order_;
+    Sampling sampling_ = Sampling::instantaneous;
+    Statistics statistics_ = Statistics::none;
+    Compression compression_;
+    Storage storage_;
     bool report_is_closed_;
     hid_t file_handler_ = 0;
 };
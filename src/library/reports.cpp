@@ -5,6 +5,18 @@
 
 bbp::sonata::SonataReport sonata_report;
 
+namespace {
+
+bbp::sonata::Report* to_report(sonata_report_handle_t handle) {
+    return reinterpret_cast<bbp::sonata::Report*>(handle);
+}
+
+bbp::sonata::NodeTable* to_population(sonata_population_handle_t handle) {
+    return reinterpret_cast<bbp::sonata::NodeTable*>(handle);
+}
+
+}  // namespace
+
 int sonata_clear() {
     sonata_report.clear();
     return 0;
@@ -27,16 +39,85 @@ int sonata_create_report(const char* report_name,
     return 0;
 }
 
+sonata_report_handle_t sonata_get_report_handle(const char* report_name) {
+    if (!sonata_report.report_exists(report_name)) {
+        return nullptr;
+    }
+    return reinterpret_cast<sonata_report_handle_t>(sonata_report.get_report(report_name).get());
+}
+
+sonata_population_handle_t sonata_get_population_handle(sonata_report_handle_t report,
+                                                        const char* population_name) {
+    if (report == nullptr) {
+        return nullptr;
+    }
+    try {
+        auto population = to_report(report)->get_population(population_name);
+        return reinterpret_cast<sonata_population_handle_t>(population.get());
+    } catch (const std::out_of_range&) {
+        return nullptr;
+    }
+}
+
 int sonata_add_node(const char* report_name,
                     const char* population_name,
                     uint64_t population_offset,
                     uint64_t node_id) {
+    return sonata_report_add_node(
+        sonata_get_report_handle(report_name), population_name, population_offset, node_id);
+}
+
+int sonata_add_nodes(const char* report_name,
+                     const char* population_name,
+                     uint64_t population_offset,
+                     const uint64_t* node_ids,
+                     uint64_t num_nodes) {
     if (!sonata_report.report_exists(report_name)) {
         return -2;
     }
     try {
         auto report = sonata_report.get_report(report_name);
-        report->add_node(population_name, population_offset, node_id);
+        report->add_nodes(population_name, population_offset, node_ids, num_nodes);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -1;
+    }
+    return 0;
+}
+
+int sonata_add_elements_bulk(const char* report_name,
+                             const char* population_name,
+                             const uint64_t* node_ids,
+                             uint64_t num_nodes,
+                             const uint64_t* offsets,
+                             const uint32_t* element_ids,
+                             double* const* element_values) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -2;
+    }
+    try {
+        auto report = sonata_report.get_report(report_name);
+        report->add_elements(
+            population_name, node_ids, num_nodes, offsets, element_ids, element_values);
+    } catch (const std::out_of_range& err) {
+        logger->error(err.what());
+        return -3;
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -1;
+    }
+    return 0;
+}
+
+int sonata_report_add_node(sonata_report_handle_t report,
+                           const char* population_name,
+                           uint64_t population_offset,
+                           uint64_t node_id) {
+    if (report == nullptr) {
+        return -2;
+    }
+    try {
+        to_report(report)->add_node(population_name, population_offset, node_id);
     } catch (const std::exception& err) {
         logger->error(err.what());
         return -1;
@@ -49,13 +130,93 @@ int sonata_add_element(const char* report_name,
                        uint64_t node_id,
                        uint32_t element_id,
                        double* voltage) {
+    sonata_report_handle_t report = sonata_get_report_handle(report_name);
+    if (report == nullptr) {
+        return -2;
+    }
+    sonata_population_handle_t population = sonata_get_population_handle(report,
+                                                                          population_name);
+    if (population == nullptr) {
+        logger->error("Population {} doesn't exist", population_name);
+        return -3;
+    }
+    return sonata_population_add_element(population, node_id, element_id, voltage);
+}
+
+int sonata_population_add_element(sonata_population_handle_t population,
+                                  uint64_t node_id,
+                                  uint32_t element_id,
+                                  double* voltage) {
+    if (population == nullptr) {
+        return -2;
+    }
+    try {
+        to_population(population)->add_element(node_id, voltage, element_id);
+    } catch (const std::out_of_range& err) {
+        logger->error(err.what());
+        return -3;
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -1;
+    }
+    return 0;
+}
+
+int sonata_add_weighted_element(const char* report_name,
+                                const char* population_name,
+                                uint64_t node_id,
+                                uint32_t element_id,
+                                double* voltage,
+                                double weight) {
+    sonata_report_handle_t report = sonata_get_report_handle(report_name);
+    if (report == nullptr) {
+        return -2;
+    }
+    sonata_population_handle_t population = sonata_get_population_handle(report,
+                                                                          population_name);
+    if (population == nullptr) {
+        logger->error("Population {} doesn't exist", population_name);
+        return -3;
+    }
+    return sonata_population_add_weighted_element(
+        population, node_id, element_id, voltage, weight);
+}
+
+int sonata_population_add_weighted_element(sonata_population_handle_t population,
+                                           uint64_t node_id,
+                                           uint32_t element_id,
+                                           double* voltage,
+                                           double weight) {
+    if (population == nullptr) {
+        return -2;
+    }
+    try {
+        to_population(population)->add_weighted_element(node_id, voltage, element_id, weight);
+    } catch (const std::out_of_range& err) {
+        logger->error(err.what());
+        return -3;
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -1;
+    }
+    return 0;
+}
+
+int sonata_add_elements_indexed(const char* report_name,
+                                const char* population_name,
+                                uint64_t node_id,
+                                const double* base,
+                                const uint32_t* indices,
+                                const uint32_t* element_ids,
+                                uint32_t num_elements) {
     if (!sonata_report.report_exists(report_name)) {
         return -2;
     }
     try {
         auto report = sonata_report.get_report(report_name);
-        auto node = report->get_node(population_name, node_id);
-        node->add_element(voltage, element_id);
+        auto population = report->get_population(population_name);
+        population->add_indexed_elements(
+            node_id, sonata_report.register_array(base), indices, element_ids, num_elements);
     } catch (const std::out_of_range& err) {
         logger->error(err.what());
         return -3;
@@ -66,6 +227,13 @@ int sonata_add_element(const char* report_name,
     return 0;
 }
 
+int sonata_rebase_array(const double* old_base, const double* new_base) {
+    if (sonata_report.rebase_array(old_base, new_base) == 0) {
+        return -1;
+    }
+    return 0;
+}
+
 void sonata_setup_communicators() {
     sonata_report.create_communicators();
 }
@@ -86,12 +254,18 @@ int sonata_record_node_data(double step,
     if (sonata_report.is_empty()) {
         return -3;
     }
-    if (!sonata_report.report_exists(report_name)) {
+    return sonata_report_record_node_data(
+        sonata_get_report_handle(report_name), step, nodeids, num_nodes);
+}
+
+int sonata_report_record_node_data(sonata_report_handle_t report,
+                                   double step,
+                                   const int* node_ids,
+                                   int num_nodes) {
+    if (report == nullptr) {
         return -1;
     }
-    const std::vector<uint64_t> node_ids(nodeids, nodeids + num_nodes);
-    auto report = sonata_report.get_report(report_name);
-    report->record_data(step, node_ids);
+    to_report(report)->record_data(step, node_ids, static_cast<size_t>(num_nodes));
     return 0;
 }
 
@@ -119,6 +293,24 @@ int sonata_flush(double time) {
     return 0;
 }
 
+int sonata_flush_begin(double time) {
+    if (sonata_report.is_empty()) {
+        return -3;
+    }
+    auto functor = std::mem_fn(&bbp::sonata::Report::flush_begin);
+    sonata_report.apply_all(functor, time);
+    return 0;
+}
+
+int sonata_flush_end(double time) {
+    if (sonata_report.is_empty()) {
+        return -3;
+    }
+    auto functor = std::mem_fn(&bbp::sonata::Report::flush_end);
+    sonata_report.apply_all(functor, time);
+    return 0;
+}
+
 int sonata_set_max_buffer_size_hint(size_t buffer_size) {
     auto functor = std::mem_fn(&bbp::sonata::Report::set_max_buffer_size);
     sonata_report.apply_all(functor, buffer_size * 1048576);
@@ -134,10 +326,166 @@ int sonata_set_report_max_buffer_size_hint(const char* report_name, size_t buffe
     return 0;
 }
 
+int sonata_set_report_node_order(const char* report_name, const char* node_order) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    try {
+        auto report = sonata_report.get_report(report_name);
+        report->set_node_order(node_order);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_sampling(const char* report_name, const char* sampling) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    try {
+        sonata_report.get_report(report_name)->set_sampling(sampling);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_summation(const char* report_name, const char* summation) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    try {
+        sonata_report.get_report(report_name)->set_summation(summation);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_statistics(const char* report_name, const char* statistics) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    try {
+        sonata_report.get_report(report_name)->set_statistics(statistics);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_compression(const char* report_name,
+                                  int level,
+                                  uint32_t chunk_steps,
+                                  uint32_t chunk_elements) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    try {
+        auto report = sonata_report.get_report(report_name);
+        auto compression = report->get_compression();
+        compression.level = level;
+        compression.chunk_steps = chunk_steps;
+        compression.chunk_elements = chunk_elements;
+        report->set_compression(compression);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_direct_chunk_write(const char* report_name, int enabled) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    auto report = sonata_report.get_report(report_name);
+    auto compression = report->get_compression();
+    compression.direct_chunk_write = enabled != 0;
+    report->set_compression(compression);
+    return 0;
+}
+
+int sonata_set_report_quantization(const char* report_name,
+                                   int bits,
+                                   double max_error,
+                                   double offset) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    bbp::sonata::Storage storage;
+    if (bits == 16) {
+        storage.type = bbp::sonata::StorageType::int16;
+    } else if (bits == 8) {
+        storage.type = bbp::sonata::StorageType::int8;
+    } else if (bits != 0) {
+        logger->error("Quantization to {} bits is not supported", bits);
+        return -2;
+    }
+    if (storage.is_quantized()) {
+        // Rounding to the nearest multiple of the scale is off by half of it at most
+        storage.scale = 2 * max_error;
+        storage.offset = offset;
+    }
+    try {
+        sonata_report.get_report(report_name)->set_storage(storage);
+    } catch (const std::exception& err) {
+        logger->error(err.what());
+        return -2;
+    }
+    return 0;
+}
+
+int sonata_set_report_precision(const char* report_name, int bits) {
+    if (!sonata_report.report_exists(report_name)) {
+        return -1;
+    }
+    bbp::sonata::Storage storage;
+    if (bits == 64) {
+        storage.type = bbp::sonata::StorageType::float64;
+    } else if (bits == 16) {
+        storage.type = bbp::sonata::StorageType::float16;
+    } else if (bits != 32) {
+        logger->error("Floats of {} bits are not supported", bits);
+        return -2;
+    }
+    sonata_report.get_report(report_name)->set_storage(storage);
+    return 0;
+}
+
 void sonata_set_atomic_step(double step) {
     bbp::sonata::SonataReport::atomic_step_ = step;
 }
 
+int sonata_set_num_threads(int num_threads) {
+    if (num_threads < 1) {
+        return -1;
+    }
+    bbp::sonata::SonataReport::set_num_threads(num_threads);
+    return 0;
+}
+
+int sonata_set_num_compression_threads(int num_threads) {
+    if (num_threads < 1) {
+        return -1;
+    }
+    bbp::sonata::SonataReport::set_num_compression_threads(num_threads);
+    return 0;
+}
+
+int sonata_set_num_write_buffers(int num_buffers) {
+    if (num_buffers < 1) {
+        return -1;
+    }
+    bbp::sonata::SonataReport::set_num_write_buffers(num_buffers);
+    return 0;
+}
+
 int sonata_get_num_reports() {
     return sonata_report.get_num_reports();
 }
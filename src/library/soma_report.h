@@ -9,10 +9,10 @@ class SomaReport: public Report
   public:
     using Report::Report;
 
-    void add_node(const std::string& population_name,
-                  uint64_t population_offset,
-                  uint64_t node_id) override;
     size_t get_total_elements(const std::string& population_name) const override;
+
+  protected:
+    std::shared_ptr<NodeTable> create_population() const override;
 };
 
 }  // namespace sonata
@@ -1,28 +1,132 @@
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 
 #include "../utils/logger.h"
+#include "../utils/rank_sets.h"
 #include "element_report.h"
 #include "implementation_interface.hpp"
 #include "soma_report.h"
 #include "sonatareport.h"
+#include "summation_report.h"
 
 namespace bbp {
 namespace sonata {
 
+namespace {
+
+// Tell reports from populations in the single exchange interning both
+constexpr char report_tag = 'r';
+constexpr char population_tag = 'p';
+
+}  // namespace
+
 double SonataReport::atomic_step_ = 1e-8;
 double SonataReport::min_steps_to_record_ = 0.0;
 bool SonataReport::first_report = true;
 int SonataReport::rank_ = 0;
+NameTable SonataReport::report_ids_;
+NameTable SonataReport::population_ids_;
+std::unique_ptr<ThreadPool> SonataReport::thread_pool_;
+std::unique_ptr<ThreadPool> SonataReport::compression_pool_;
+size_t SonataReport::num_write_buffers_ = 0;
+std::unique_ptr<WriterThread> SonataReport::writer_thread_;
 #ifdef SONATA_REPORT_HAVE_MPI
 MPI_Comm SonataReport::has_nodes_ = MPI_COMM_WORLD;
 SonataReport::communicators_t SonataReport::communicators_;
 #endif
 
+ThreadPool& SonataReport::get_thread_pool() {
+    if (!thread_pool_) {
+        const char* env = getenv("LIBSONATA_NUM_THREADS");
+        const int num_threads = env != nullptr ? std::atoi(env) : 1;
+        set_num_threads(std::max(num_threads, 1));
+    }
+    return *thread_pool_;
+}
+
+void SonataReport::set_num_threads(size_t num_threads) {
+    if (thread_pool_ && thread_pool_->size() == num_threads) {
+        return;
+    }
+    if (rank_ == 0) {
+        logger->debug("Recording with {} thread(s)", num_threads);
+    }
+    thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+}
+
+ThreadPool& SonataReport::get_compression_pool() {
+    if (!compression_pool_) {
+        const char* env = getenv("LIBSONATA_NUM_COMPRESSION_THREADS");
+        const int num_threads = env != nullptr ? std::atoi(env) : 1;
+        set_num_compression_threads(std::max(num_threads, 1));
+    }
+    return *compression_pool_;
+}
+
+void SonataReport::set_num_compression_threads(size_t num_threads) {
+    if (compression_pool_ && compression_pool_->size() == num_threads) {
+        return;
+    }
+    if (rank_ == 0) {
+        logger->debug("Compressing with {} thread(s)", num_threads);
+    }
+    compression_pool_ = std::make_unique<ThreadPool>(num_threads);
+}
+
+size_t SonataReport::get_num_write_buffers() {
+    if (num_write_buffers_ == 0) {
+        const char* env = getenv("LIBSONATA_NUM_WRITE_BUFFERS");
+        const int num_buffers = env != nullptr ? std::atoi(env) : 1;
+        num_write_buffers_ = std::max(num_buffers, 1);
+    }
+    if (num_write_buffers_ > 1 && !is_async_write_supported()) {
+        if (rank_ == 0) {
+            logger->warn("MPI_THREAD_MULTIPLE not provided, writing the reports synchronously");
+        }
+        num_write_buffers_ = 1;
+    }
+    return num_write_buffers_;
+}
+
+bool SonataReport::is_async_write_supported() {
+#ifdef SONATA_REPORT_HAVE_MPI
+    // The writer thread calls collectives while the simulation keeps using MPI
+    int provided;
+    MPI_Query_thread(&provided);
+    return provided == MPI_THREAD_MULTIPLE;
+#else
+    return true;
+#endif
+}
+
+void SonataReport::set_num_write_buffers(size_t num_buffers) {
+    if (rank_ == 0) {
+        logger->debug("Recording with {} buffer(s) per population", num_buffers);
+    }
+    num_write_buffers_ = num_buffers;
+}
+
+WriterThread& SonataReport::get_writer_thread() {
+    if (!writer_thread_) {
+        writer_thread_ = std::make_unique<WriterThread>();
+    }
+    return *writer_thread_;
+}
+
+void SonataReport::wait_for_writer() {
+    if (writer_thread_) {
+        writer_thread_->wait();
+    }
+}
+
 void SonataReport::clear() {
     for (auto& kv : reports_) {
         logger->trace("Deleting report: {} from rank {}", kv.first, SonataReport::rank_);
     }
     reports_.clear();
+    arrays_.clear();
 }
 
 bool SonataReport::is_empty() {
@@ -35,8 +139,10 @@ std::shared_ptr<Report> SonataReport::create_report(const std::string& name,
                                                     double tend,
                                                     double dt,
                                                     const std::string& units) {
-    if (kind == "compartment" || kind == "synapse" || kind == "summation") {
+    if (kind == "compartment" || kind == "synapse") {
         reports_.emplace(name, std::make_shared<ElementReport>(name, tstart, tend, dt, units));
+    } else if (kind == "summation") {
+        reports_.emplace(name, std::make_shared<SummationReport>(name, tstart, tend, dt, units));
     } else if (kind == "soma") {
         reports_.emplace(name, std::make_shared<SomaReport>(name, tstart, tend, dt, units));
     } else {
@@ -60,6 +166,18 @@ bool SonataReport::report_exists(const std::string& name) const {
     return reports_.find(name) != reports_.end();
 }
 
+const double* const* SonataReport::register_array(const double* base) {
+    return arrays_.register_array(base);
+}
+
+size_t SonataReport::rebase_array(const double* old_base, const double* new_base) {
+    logger->trace("Rebasing array {} to {} from rank {}",
+                  static_cast<const void*>(old_base),
+                  static_cast<const void*>(new_base),
+                  rank_);
+    return arrays_.rebase_array(old_base, new_base);
+}
+
 void SonataReport::create_communicators() {
     std::vector<std::string> report_names;
     report_names.reserve(reports_.size());
@@ -77,17 +195,120 @@ void SonataReport::create_communicators() {
     if (rank_ == 0 && !is_empty()) {
         logger->info("Initializing communicators and preparing SONATA datasets");
     }
+    if (is_empty()) {
+        // The ranks without reports have their own communicator
+        return;
+    }
+    intern_names();
+    std::vector<uint32_t> report_ids;
+    report_ids.reserve(report_names.size());
+    for (const auto& report_name : report_names) {
+        report_ids.push_back(report_ids_.find(report_name));
+    }
+    Implementation::add_communicators(report_ids);
+}
+
+void SonataReport::intern_names() {
+    std::vector<std::string> local_names;
+    for (const auto& kv : reports_) {
+        local_names.push_back(report_tag + kv.first);
+        for (const auto& population_name : kv.second->get_population_names()) {
+            local_names.push_back(population_tag + population_name);
+        }
+    }
+    // Every rank interns the same sorted names, so that they all assign the same ids
+    for (const auto& name : Implementation::sync_names(local_names)) {
+        NameTable& ids = name[0] == report_tag ? report_ids_ : population_ids_;
+        ids.intern(name.substr(1));
+    }
 }
 
 void SonataReport::prepare_datasets() {
-    for (auto& kv : reports_) {
-        logger->trace("Preparing datasets of report {} from rank {}", kv.first, rank_);
-        kv.second->prepare_dataset();
+    if (reports_.empty()) {
+        // The ranks without reports have their own communicator
+        return;
+    }
+    wait_for_writer();
+
+    // Populations of every report on any rank as a bitmap reduction over their ids, the bit p of
+    // the words of report r being set if a rank has the population p in the report r. The first
+    // word flags a rank with names not interned yet, added since the communicators were created.
+    size_t num_words;
+    std::vector<uint64_t> bitmap;
+    for (bool interned = false; !interned;) {
+        num_words = RankSets::get_num_words(population_ids_.size());
+        bitmap.assign(1 + report_ids_.size() * num_words, 0);
+        for (const auto& kv : reports_) {
+            const uint32_t report_id = report_ids_.find(kv.first);
+            for (const auto& population_name : kv.second->get_population_names()) {
+                const uint32_t population_id = population_ids_.find(population_name);
+                if (report_id == NameTable::npos || population_id == NameTable::npos) {
+                    bitmap[0] = 1;
+                    continue;
+                }
+                bitmap[1 + report_id * num_words + population_id / 64] |= uint64_t{1}
+                                                                        << (population_id % 64);
+            }
+        }
+        Implementation::reduce_bitmap(bitmap);
+        interned = bitmap[0] == 0;
+        if (!interned) {
+            intern_names();
+        }
+    }
+
+    // Create the populations of the reports of this rank, and gather the sizes of all of them in
+    // a single exchange, the reports of other ranks counting as empty populations
+    const std::vector<uint64_t> no_population = {0, 0, std::numeric_limits<uint32_t>::max()};
+    std::vector<uint64_t> counts;
+    struct LocalReport {
+        std::shared_ptr<Report> report;
+        // Layouts of its populations
+        size_t first;
+        size_t last;
+    };
+    std::vector<LocalReport> local_reports;
+    size_t num_populations = 0;
+    for (uint32_t report_id = 0; report_id < report_ids_.size(); ++report_id) {
+        std::vector<std::string> population_names;
+        for (uint32_t population_id = 0; population_id < population_ids_.size();
+             ++population_id) {
+            const uint64_t word = bitmap[1 + report_id * num_words + population_id / 64];
+            if (word >> (population_id % 64) & 1) {
+                population_names.push_back(population_ids_.get_name(population_id));
+            }
+        }
+        const size_t first = num_populations;
+        num_populations += population_names.size();
+
+        const std::string& report_name = report_ids_.get_name(report_id);
+        if (report_exists(report_name)) {
+            logger->trace("Preparing datasets of report {} from rank {}", report_name, rank_);
+            const auto report = get_report(report_name);
+            report->create_populations(population_names);
+            const auto report_counts = report->get_local_counts();
+            counts.insert(counts.end(), report_counts.begin(), report_counts.end());
+            local_reports.push_back({report, first, num_populations});
+        } else {
+            for (size_t i = first; i < num_populations; ++i) {
+                counts.insert(counts.end(), no_population.begin(), no_population.end());
+            }
+        }
+    }
+    const auto layouts = PopulationLayout::from_counts(Implementation::gather_report_counts(counts),
+                                                       num_populations,
+                                                       Implementation::get_report_rank());
+
+    for (const auto& local_report : local_reports) {
+        local_report.report->prepare_populations(
+            std::vector<PopulationLayout>(layouts.begin() + local_report.first,
+                                          layouts.begin() + local_report.last));
     }
 }
 
 void SonataReport::create_spikefile(const std::string& output_dir, const std::string& filename) {
     std::string report_name = output_dir + "/" + filename;
+    wait_for_writer();
     spike_data_ = std::make_unique<SonataData>(report_name);
 }
 
@@ -102,10 +323,12 @@ void SonataReport::add_spikes_population(const std::string& population_name,
 }
 
 void SonataReport::write_spike_populations() {
+    wait_for_writer();
     spike_data_->write_spike_populations();
 }
 
 void SonataReport::close_spikefile() {
+    wait_for_writer();
     spike_data_->close();
 }
 
@@ -8,6 +8,10 @@
 #include <mpi.h>
 #endif
 
+#include "../data/array_registry.h"
+#include "../utils/name_table.h"
+#include "../utils/thread_pool.h"
+#include "../utils/writer_thread.h"
 #include "report.h"
 
 namespace bbp {
@@ -20,7 +24,8 @@ class SonataReport
 {
     using reports_t = std::map<std::string, std::shared_ptr<Report>>;
 #ifdef SONATA_REPORT_HAVE_MPI
-    using communicators_t = std::unordered_map<std::string, MPI_Comm>;
+    // Indexed by report id
+    using communicators_t = std::vector<MPI_Comm>;
 #endif
   public:
     static double atomic_step_;
@@ -32,6 +37,48 @@ class SonataReport
     static int rank_;
     static bool first_report;
 
+    /**
+     * \brief Ids of the reports and of the populations of any report, the same on every rank with
+     * reports. Interned when creating the communicators, so that the later collectives exchange
+     * ids instead of names.
+     */
+    static NameTable report_ids_;
+    static NameTable population_ids_;
+
+    /**
+     * \brief Threads recording each population, taken from LIBSONATA_NUM_THREADS if set and 1
+     * otherwise until set_num_threads is called
+     */
+    static ThreadPool& get_thread_pool();
+    static void set_num_threads(size_t num_threads);
+    /**
+     * \brief Threads compressing the chunks written directly, taken from
+     * LIBSONATA_NUM_COMPRESSION_THREADS if set and 1 otherwise until set_num_compression_threads
+     * is called. Kept apart from the recording threads, as the writer thread compresses while the
+     * simulation records.
+     */
+    static ThreadPool& get_compression_pool();
+    static void set_num_compression_threads(size_t num_threads);
+
+    /**
+     * \brief Buffers of each population, taken from LIBSONATA_NUM_WRITE_BUFFERS if set and 1
+     * otherwise until set_num_write_buffers is called. With more than one, the full buffers are
+     * written by the writer thread. Always 1 if MPI does not provide MPI_THREAD_MULTIPLE.
+     */
+    static size_t get_num_write_buffers();
+    /**
+     * \brief Whether the writer thread can write while the simulation keeps using MPI
+     */
+    static bool is_async_write_supported();
+    static void set_num_write_buffers(size_t num_buffers);
+    static WriterThread& get_writer_thread();
+    /**
+     * \brief Wait for every write queued on the writer thread, of any report. Called before any
+     * other HDF5 call that may run while the writer thread writes: closing the files, writing the
+     * statistics and the spikes.
+     */
+    static void wait_for_writer();
+
     /**
      * \brief Destroy all report objects.
      * This should invoke their destructor which will close the report
@@ -55,6 +102,9 @@ class SonataReport
 
     bool report_exists(const std::string& name) const;
 
+    const double* const* register_array(const double* base);
+    size_t rebase_array(const double* old_base, const double* new_base);
+
     void create_communicators();
     void prepare_datasets();
 
@@ -75,7 +125,18 @@ class SonataReport
     }
 
   private:
+    /**
+     * \brief Intern the reports and populations of every rank with reports not interned yet
+     */
+    void intern_names();
+
+    static std::unique_ptr<ThreadPool> thread_pool_;
+    static std::unique_ptr<ThreadPool> compression_pool_;
+    static size_t num_write_buffers_;
+    static std::unique_ptr<WriterThread> writer_thread_;
+
     reports_t reports_;
+    ArrayRegistry arrays_;
     std::unique_ptr<SonataData> spike_data_;
 };
 
@@ -0,0 +1,29 @@
+#include <stdexcept>
+
+#include "summation_report.h"
+
+namespace bbp {
+namespace sonata {
+
+std::shared_ptr<NodeTable> SummationReport::create_population() const {
+    // The elements with the same id are summed together, so they must be consecutive
+    return std::make_shared<NodeTable>(NodeTable::unlimited, arena_, true);
+}
+
+size_t SummationReport::get_total_elements(const std::string& population_name) const {
+    const auto& nodes = populations_->at(population_name);
+    return SummationPlan::count_columns(*nodes, summation_ == Summation::by_node);
+}
+
+void SummationReport::set_summation(const std::string& summation) {
+    if (summation == "element") {
+        summation_ = Summation::by_element;
+    } else if (summation == "node") {
+        summation_ = Summation::by_node;
+    } else {
+        throw std::runtime_error("Summation " + summation + " does not exist");
+    }
+}
+
+}  // namespace sonata
+}  // namespace bbp
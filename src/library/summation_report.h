@@ -0,0 +1,30 @@
+#pragma once
+#include "report.h"
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Report of the weighted sums of the elements of each node, either of the elements with the
+ * same id or of all of them, instead of every element
+ */
+class SummationReport: public Report
+{
+  public:
+    using Report::Report;
+
+    size_t get_total_elements(const std::string& population_name) const override;
+    void set_summation(const std::string& summation) override;
+
+  protected:
+    std::shared_ptr<NodeTable> create_population() const override;
+    Summation get_summation() const noexcept override {
+        return summation_;
+    }
+
+  private:
+    Summation summation_ = Summation::by_element;
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Allocator leaving the values of resized containers uninitialized, so that the memory
+ * pages are first touched by whoever writes them first
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class DefaultInitAllocator: public Allocator
+{
+    using traits = std::allocator_traits<Allocator>;
+
+  public:
+    template <typename U>
+    struct rebind {
+        using other = DefaultInitAllocator<U, typename traits::template rebind_alloc<U>>;
+    };
+
+    using Allocator::Allocator;
+
+    template <typename U>
+    void construct(U* ptr) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(ptr)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) {
+        traits::construct(static_cast<Allocator&>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,22 @@
+#include "name_table.h"
+
+namespace bbp {
+namespace sonata {
+
+constexpr uint32_t NameTable::npos;
+
+uint32_t NameTable::intern(const std::string& name) {
+    const auto inserted = ids_.emplace(name, static_cast<uint32_t>(names_.size()));
+    if (inserted.second) {
+        names_.push_back(name);
+    }
+    return inserted.first->second;
+}
+
+uint32_t NameTable::find(const std::string& name) const noexcept {
+    const auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : npos;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Dense integer ids of names, assigned in the order the names are first interned. Ranks
+ * interning the same names in the same order agree on their ids, so that collectives can exchange
+ * ids and bitmaps instead of strings.
+ */
+class NameTable
+{
+  public:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * \return the id of name, the next free one if name is new
+     */
+    uint32_t intern(const std::string& name);
+    /**
+     * \return the id of name, npos if it was never interned
+     */
+    uint32_t find(const std::string& name) const noexcept;
+    const std::string& get_name(uint32_t id) const {
+        return names_.at(id);
+    }
+    size_t size() const noexcept {
+        return names_.size();
+    }
+
+  private:
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<std::string> names_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
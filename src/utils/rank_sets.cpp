@@ -0,0 +1,65 @@
+#include <unordered_map>
+
+#include "rank_sets.h"
+
+namespace bbp {
+namespace sonata {
+
+RankSets::RankSets(const std::vector<uint64_t>& report_bitmaps, size_t num_reports)
+    : report_bitmaps_(report_bitmaps)
+    , num_words_(get_num_words(num_reports))
+    , num_ranks_(num_words_ == 0 ? 0 : report_bitmaps.size() / num_words_)
+    , leaders_(num_reports) {
+    // FNV-1a hash of the ranks of each report
+    std::vector<uint64_t> hashes(num_reports, 14695981039346656037ull);
+    for (size_t rank = 0; rank < num_ranks_; ++rank) {
+        for (size_t report = 0; report < num_reports; ++report) {
+            if (has_rank(report, static_cast<int>(rank))) {
+                hashes[report] = (hashes[report] ^ rank) * 1099511628211ull;
+            }
+        }
+    }
+
+    // Reports with the same hash are compared rank by rank in case of collisions
+    std::unordered_multimap<uint64_t, size_t> leaders_by_hash;
+    for (size_t report = 0; report < num_reports; ++report) {
+        leaders_[report] = report;
+        const auto candidates = leaders_by_hash.equal_range(hashes[report]);
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            if (same_ranks(it->second, report)) {
+                leaders_[report] = it->second;
+                break;
+            }
+        }
+        if (leaders_[report] == report) {
+            leaders_by_hash.emplace(hashes[report], report);
+        }
+    }
+}
+
+std::vector<int> RankSets::get_ranks(size_t report) const {
+    std::vector<int> ranks;
+    for (size_t rank = 0; rank < num_ranks_; ++rank) {
+        if (has_rank(report, static_cast<int>(rank))) {
+            ranks.push_back(static_cast<int>(rank));
+        }
+    }
+    return ranks;
+}
+
+bool RankSets::has_rank(size_t report, int rank) const noexcept {
+    const uint64_t word = report_bitmaps_[rank * num_words_ + report / 64];
+    return (word >> (report % 64)) & 1;
+}
+
+bool RankSets::same_ranks(size_t lhs, size_t rhs) const noexcept {
+    for (size_t rank = 0; rank < num_ranks_; ++rank) {
+        if (has_rank(lhs, static_cast<int>(rank)) != has_rank(rhs, static_cast<int>(rank))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Ranks taking part in each report, from a bitmap of the reports of every rank. Reports
+ * with exactly the same ranks are detected by hashing their membership, so that they can share a
+ * single communicator.
+ */
+class RankSets
+{
+  public:
+    /**
+     * \param report_bitmaps get_num_words(num_reports) words per rank in rank order, the bit r
+     * being set if the rank has the report r
+     */
+    RankSets(const std::vector<uint64_t>& report_bitmaps, size_t num_reports);
+
+    static size_t get_num_words(size_t num_reports) noexcept {
+        return (num_reports + 63) / 64;
+    }
+    /**
+     * \brief Set the bit of report in the bitmap of a rank
+     */
+    static void add_report(std::vector<uint64_t>& bitmap, size_t report) noexcept {
+        bitmap[report / 64] |= uint64_t{1} << (report % 64);
+    }
+
+    /**
+     * \brief The first report with the same ranks as report, itself if there is none
+     */
+    size_t get_leader(size_t report) const noexcept {
+        return leaders_[report];
+    }
+    /**
+     * \brief The ranks of report in increasing order
+     */
+    std::vector<int> get_ranks(size_t report) const;
+    bool has_rank(size_t report, int rank) const noexcept;
+
+  private:
+    bool same_ranks(size_t lhs, size_t rhs) const noexcept;
+
+    std::vector<uint64_t> report_bitmaps_;
+    size_t num_words_;
+    size_t num_ranks_;
+    std::vector<size_t> leaders_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "spike_sort.h"
+
+namespace bbp {
+namespace sonata {
+
+namespace {
+
+constexpr size_t num_digits = 16;
+constexpr size_t digit_values = 256;
+// Below it the histograms cost more than comparing
+constexpr size_t min_radix_size = 1024;
+// Samples gathered by a single rank to select the splitters
+constexpr uint64_t max_samples = uint64_t{1} << 22;
+
+inline uint8_t get_digit(const SpikeKey& key, size_t digit) noexcept {
+    const uint64_t word = digit < 8 ? key.low : key.high;
+    return static_cast<uint8_t>(word >> (8 * (digit % 8)));
+}
+
+}  // namespace
+
+uint64_t to_time_bits(double time) noexcept {
+    // Adding 0.0 turns -0.0 into 0.0
+    time += 0.0;
+    uint64_t bits;
+    std::memcpy(&bits, &time, sizeof(bits));
+    // Negative times are ordered backwards by their magnitude bits
+    const uint64_t sign = uint64_t{1} << 63;
+    return (bits & sign) ? ~bits : bits | sign;
+}
+
+double from_time_bits(uint64_t bits) noexcept {
+    const uint64_t sign = uint64_t{1} << 63;
+    bits = (bits & sign) ? bits & ~sign : ~bits;
+    double time;
+    std::memcpy(&time, &bits, sizeof(time));
+    return time;
+}
+
+void sort_spike_keys(std::vector<SpikeKey>& keys) {
+    const size_t size = keys.size();
+    if (size < min_radix_size) {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+
+    // Histograms of every digit in a single pass
+    std::vector<std::array<size_t, digit_values>> counts(num_digits);
+    for (auto& digit_counts : counts) {
+        digit_counts.fill(0);
+    }
+    for (const SpikeKey& key : keys) {
+        for (size_t digit = 0; digit < num_digits; ++digit) {
+            ++counts[digit][get_digit(key, digit)];
+        }
+    }
+
+    std::vector<SpikeKey> scratch(size);
+    SpikeKey* source = keys.data();
+    SpikeKey* destination = scratch.data();
+    for (size_t digit = 0; digit < num_digits; ++digit) {
+        auto& offsets = counts[digit];
+        if (offsets[get_digit(source[0], digit)] == size) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t& count : offsets) {
+            const size_t digit_count = count;
+            count = offset;
+            offset += digit_count;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            destination[offsets[get_digit(source[i], digit)]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+    if (source != keys.data()) {
+        keys.swap(scratch);
+    }
+}
+
+std::vector<SpikeKey> pack_spikes(const std::vector<double>& times,
+                                  const std::vector<uint64_t>& node_ids,
+                                  bool by_id) {
+    std::vector<SpikeKey> keys(times.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = to_spike_key(times[i], node_ids[i], by_id);
+    }
+    return keys;
+}
+
+void unpack_spikes(const std::vector<SpikeKey>& keys,
+                   bool by_id,
+                   std::vector<double>& times,
+                   std::vector<uint64_t>& node_ids) {
+    times.resize(keys.size());
+    node_ids.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        times[i] = from_time_bits(by_id ? keys[i].low : keys[i].high);
+        node_ids[i] = by_id ? keys[i].high : keys[i].low;
+    }
+}
+
+size_t get_sample_stride(uint64_t total_spikes, size_t num_parts) noexcept {
+    const uint64_t parts = std::max<size_t>(num_parts, 1);
+    const uint64_t num_samples = std::min(parts * parts, max_samples);
+    return static_cast<size_t>(std::max<uint64_t>(total_spikes / num_samples, 1));
+}
+
+std::vector<SpikeKey> sample_spike_keys(const std::vector<SpikeKey>& sorted_keys, size_t stride) {
+    std::vector<SpikeKey> samples;
+    stride = std::max<size_t>(stride, 1);
+    samples.reserve(sorted_keys.size() / stride + 1);
+    for (size_t i = stride / 2; i < sorted_keys.size(); i += stride) {
+        samples.push_back(sorted_keys[i]);
+    }
+    return samples;
+}
+
+std::vector<SpikeKey> select_splitters(std::vector<SpikeKey>& samples, size_t num_parts) {
+    std::sort(samples.begin(), samples.end());
+    std::vector<SpikeKey> splitters;
+    if (samples.empty()) {
+        return splitters;
+    }
+    splitters.reserve(num_parts - 1);
+    for (size_t part = 1; part < num_parts; ++part) {
+        splitters.push_back(samples[part * samples.size() / num_parts]);
+    }
+    return splitters;
+}
+
+std::vector<size_t> count_parts(const std::vector<SpikeKey>& sorted_keys,
+                                const std::vector<SpikeKey>& splitters,
+                                size_t num_parts) {
+    std::vector<size_t> counts(num_parts, 0);
+    auto begin = sorted_keys.begin();
+    for (size_t part = 0; part < splitters.size() && part + 1 < num_parts; ++part) {
+        const auto end = std::lower_bound(begin, sorted_keys.end(), splitters[part]);
+        counts[part] = static_cast<size_t>(end - begin);
+        begin = end;
+    }
+    const size_t last = std::min(splitters.size(), num_parts - 1);
+    counts[last] = static_cast<size_t>(sorted_keys.end() - begin);
+    return counts;
+}
+
+void sort_spikes(std::vector<double>& times,
+                 std::vector<uint64_t>& node_ids,
+                 const std::string& order_by) {
+    if (order_by != "by_time" && order_by != "by_id") {
+        return;
+    }
+    const bool by_id = order_by == "by_id";
+    // The keys are the only copy of the spikes until they are unpacked
+    std::vector<SpikeKey> keys = pack_spikes(times, node_ids, by_id);
+    std::vector<double>().swap(times);
+    std::vector<uint64_t>().swap(node_ids);
+    sort_spike_keys(keys);
+    unpack_spikes(keys, by_id, times, node_ids);
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Spike packed as a 128 bit key ordered as unsigned integers, high then low: the time as
+ * its IEEE 754 bits made monotonic and the node id, in either order
+ */
+struct SpikeKey {
+    uint64_t high;
+    uint64_t low;
+};
+
+inline bool operator<(const SpikeKey& lhs, const SpikeKey& rhs) noexcept {
+    return lhs.high < rhs.high || (lhs.high == rhs.high && lhs.low < rhs.low);
+}
+
+/**
+ * \brief Bits of a time ordered as the times are, -0.0 being 0.0
+ */
+uint64_t to_time_bits(double time) noexcept;
+double from_time_bits(uint64_t bits) noexcept;
+
+/**
+ * \param by_id order by node id then by time instead of by time then by node id
+ */
+inline SpikeKey to_spike_key(double time, uint64_t node_id, bool by_id) noexcept {
+    const uint64_t time_bits = to_time_bits(time);
+    return by_id ? SpikeKey{node_id, time_bits} : SpikeKey{time_bits, node_id};
+}
+
+/**
+ * \brief Sort keys with an LSD radix sort of byte digits, the digits equal in every key being
+ * skipped. Small arrays are sorted by comparison.
+ */
+void sort_spike_keys(std::vector<SpikeKey>& keys);
+
+/**
+ * \brief Pack the spikes into keys, the keys being the only copy of the spikes
+ */
+std::vector<SpikeKey> pack_spikes(const std::vector<double>& times,
+                                  const std::vector<uint64_t>& node_ids,
+                                  bool by_id);
+/**
+ * \brief Unpack the keys into times and node ids, resized to the number of keys
+ */
+void unpack_spikes(const std::vector<SpikeKey>& keys,
+                   bool by_id,
+                   std::vector<double>& times,
+                   std::vector<uint64_t>& node_ids);
+
+/**
+ * \brief Stride of the samples of a sample sort of total_spikes spikes into num_parts parts:
+ * num_parts samples per part, which keeps every part under twice the mean, up to 4M samples
+ */
+size_t get_sample_stride(uint64_t total_spikes, size_t num_parts) noexcept;
+/**
+ * \brief Samples of a sample sort across ranks: every stride keys of sorted keys starting at
+ * stride / 2, so that with the same stride on every rank each sample stands for as many spikes
+ */
+std::vector<SpikeKey> sample_spike_keys(const std::vector<SpikeKey>& sorted_keys, size_t stride);
+/**
+ * \brief num_parts - 1 splitters evenly spaced among the samples of every rank, sorted in place.
+ * None without samples, the same sample being repeated if there are fewer than parts.
+ */
+std::vector<SpikeKey> select_splitters(std::vector<SpikeKey>& samples, size_t num_parts);
+/**
+ * \brief Number of sorted keys in each of num_parts parts, part i holding the keys from
+ * splitters[i - 1] included to splitters[i] excluded and the last parts the keys left
+ */
+std::vector<size_t> count_parts(const std::vector<SpikeKey>& sorted_keys,
+                                const std::vector<SpikeKey>& splitters,
+                                size_t num_parts);
+
+/**
+ * \brief Sort spikes in place by time then node id for "by_time" or by node id then time for
+ * "by_id", leaving them as they are for any other order
+ */
+void sort_spikes(std::vector<double>& times,
+                 std::vector<uint64_t>& node_ids,
+                 const std::string& order_by);
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace bbp {
+namespace sonata {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    for (size_t thread = 1; thread < num_threads; ++thread) {
+        workers_.emplace_back(&ThreadPool::work, this, thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(const std::function<void(size_t)>& task) {
+    if (workers_.empty()) {
+        task(0);
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = workers_.size();
+        ++generation_;
+    }
+    task_ready_.notify_all();
+    task(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::work(size_t thread) {
+    size_t generation = 0;
+    while (true) {
+        const std::function<void(size_t)>* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_ready_.wait(lock, [&] { return stop_ || generation_ != generation; });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+            task = task_;
+        }
+        (*task)(thread);
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last = --pending_ == 0;
+        }
+        if (last) {
+            task_done_.notify_one();
+        }
+    }
+}
+
+std::pair<size_t, size_t> partition(size_t size,
+                                    size_t thread,
+                                    size_t num_threads,
+                                    size_t alignment) {
+    size_t chunk = (size + num_threads - 1) / num_threads;
+    chunk = (chunk + alignment - 1) / alignment * alignment;
+    const size_t begin = std::min(size, thread * chunk);
+    const size_t end = std::min(size, begin + chunk);
+    return {begin, end};
+}
+
+}  // namespace sonata
+}  // namespace bbp
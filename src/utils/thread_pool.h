@@ -0,0 +1,64 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Fixed set of threads running the same task together, the calling thread being one of
+ * them. Meant for short data-parallel loops over a buffer, so the workers stay alive between
+ * tasks instead of being spawned at every step.
+ */
+class ThreadPool
+{
+  public:
+    /**
+     * \param num_threads total number of threads running a task, including the caller
+     */
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const noexcept {
+        return workers_.size() + 1;
+    }
+
+    /**
+     * \brief Call task(thread) once on every thread, thread 0 being the caller, and wait for all
+     * of them. The task must not throw. Concurrent callers run their tasks one after the other.
+     */
+    void run(const std::function<void(size_t)>& task);
+
+  private:
+    void work(size_t thread);
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable task_done_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t generation_ = 0;
+    size_t pending_ = 0;
+    bool stop_ = false;
+};
+
+/**
+ * \brief Split [0, size) into parts for num_threads threads, aligned to alignment elements
+ * \return the part [begin, end) of thread
+ */
+std::pair<size_t, size_t> partition(size_t size,
+                                    size_t thread,
+                                    size_t num_threads,
+                                    size_t alignment = 1);
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,53 @@
+#include "writer_thread.h"
+
+namespace bbp {
+namespace sonata {
+
+WriterThread::WriterThread()
+    : thread_(&WriterThread::work, this) {}
+
+WriterThread::~WriterThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_ready_.notify_one();
+    thread_.join();
+}
+
+void WriterThread::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_ready_.notify_one();
+}
+
+void WriterThread::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return tasks_.empty() && !running_; });
+}
+
+void WriterThread::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            running_ = false;
+            if (tasks_.empty()) {
+                idle_.notify_all();
+            }
+            task_ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            running_ = true;
+        }
+        task();
+    }
+}
+
+}  // namespace sonata
+}  // namespace bbp
@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace bbp {
+namespace sonata {
+
+/**
+ * \brief Background thread running tasks one at a time in the order they are submitted. Used to
+ * write the full report buffers while the simulation keeps recording. HDF5 is not thread safe, so
+ * the other threads wait for the queued tasks before their own HDF5 calls.
+ */
+class WriterThread
+{
+  public:
+    WriterThread();
+    /**
+     * \brief Run the tasks still queued and stop the thread
+     */
+    ~WriterThread();
+
+    WriterThread(const WriterThread&) = delete;
+    WriterThread& operator=(const WriterThread&) = delete;
+
+    /**
+     * \brief Queue task to be run after the previously submitted ones. The task must not throw.
+     */
+    void submit(std::function<void()> task);
+    /**
+     * \brief Wait until every task submitted so far has run, so that the caller can use HDF5
+     */
+    void wait();
+
+  private:
+    void work();
+
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable idle_;
+    std::deque<std::function<void()>> tasks_;
+    bool running_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+}  // namespace sonata
+}  // namespace bbp
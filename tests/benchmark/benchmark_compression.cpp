@@ -0,0 +1,131 @@
+/**
+ * \file
+ * \brief Write throughput of a compressed report through the HDF5 filters, and with the chunks
+ * compressed by the library on 1, 2, 4, ... up to max_threads threads and written directly. The
+ * throughput is the one of the uncompressed data.
+ *
+ * Usage: reports_benchmark_compression [num_nodes] [elements_per_node] [num_steps] [max_threads]
+ * [level]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SONATA_REPORT_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <bbp/sonata/reports.h>
+#include <utils/logger.h>
+
+double run(const std::string& report_name,
+           bool direct_chunk_write,
+           int level,
+           std::vector<double>& voltages,
+           uint32_t elements_per_node,
+           int num_steps) {
+    const char* population_name = "All";
+    const double dt = 1.0;
+    const uint64_t num_nodes = voltages.size() / elements_per_node;
+    sonata_create_report(report_name.c_str(), 0.0, num_steps * dt, dt, "mV", "compartment");
+
+    std::vector<uint64_t> node_ids(num_nodes);
+    std::iota(node_ids.begin(), node_ids.end(), 1);
+    std::vector<uint64_t> offsets(num_nodes + 1);
+    std::vector<uint32_t> element_ids(voltages.size());
+    std::vector<double*> element_values(voltages.size());
+    for (uint64_t node = 0; node < num_nodes; ++node) {
+        offsets[node + 1] = offsets[node] + elements_per_node;
+        for (uint32_t i = 0; i < elements_per_node; ++i) {
+            element_ids[offsets[node] + i] = i;
+            element_values[offsets[node] + i] = &voltages[offsets[node] + i];
+        }
+    }
+    sonata_add_nodes(report_name.c_str(), population_name, 0, node_ids.data(), num_nodes);
+    sonata_add_elements_bulk(report_name.c_str(),
+                             population_name,
+                             node_ids.data(),
+                             num_nodes,
+                             offsets.data(),
+                             element_ids.data(),
+                             element_values.data());
+
+    // Keep every step in memory so that only the final write is measured
+    size_t buffer_size = voltages.size() * sizeof(float) * num_steps;
+    sonata_set_report_max_buffer_size_hint(report_name.c_str(), buffer_size / 1048576 + 1);
+    sonata_set_report_compression(report_name.c_str(), level, 0, 0);
+    sonata_set_report_direct_chunk_write(report_name.c_str(), direct_chunk_write);
+    sonata_set_atomic_step(dt);
+    sonata_setup_communicators();
+    sonata_prepare_datasets();
+
+    // Smooth traces, compressible as membrane potentials are. The buffer gets written when its
+    // last step is recorded, so the recording is timed along with the write.
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0.0, 0.1);
+    std::chrono::duration<double> time(0);
+    for (int step = 0; step < num_steps; ++step) {
+        for (double& voltage : voltages) {
+            voltage += noise(generator);
+        }
+        auto start = std::chrono::steady_clock::now();
+        sonata_record_data(step);
+        time += std::chrono::steady_clock::now() - start;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    sonata_flush(num_steps * dt);
+    time += std::chrono::steady_clock::now() - start;
+    sonata_clear();
+    return time.count();
+}
+
+int main(int argc, char* argv[]) {
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Init(nullptr, nullptr);
+#endif
+    const uint32_t num_nodes = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const uint32_t elements_per_node = argc > 2 ? std::atoi(argv[2]) : 20;
+    const int num_steps = argc > 3 ? std::atoi(argv[3]) : 100;
+    const int max_threads = argc > 4 ? std::atoi(argv[4])
+                                     : std::max(1u, std::thread::hardware_concurrency());
+    const int level = argc > 5 ? std::atoi(argv[5]) : 4;
+
+    std::vector<double> voltages(static_cast<size_t>(num_nodes) * elements_per_node, -65.0);
+    const double megabytes = voltages.size() * sizeof(float) * num_steps / 1048576.0;
+    logger->info("{} nodes with {} elements each, {} steps, {:.1f} MB at level {}",
+                 num_nodes,
+                 elements_per_node,
+                 num_steps,
+                 megabytes,
+                 level);
+
+    double time = run(
+        "benchmark_compression_filters", false, level, voltages, elements_per_node, num_steps);
+    logger->info("HDF5 filters: {:.1f} MB/s", megabytes / time);
+    for (int num_threads = 1;; num_threads = std::min(2 * num_threads, max_threads)) {
+        sonata_set_num_compression_threads(num_threads);
+        time = run("benchmark_compression_direct_" + std::to_string(num_threads),
+                   true,
+                   level,
+                   voltages,
+                   elements_per_node,
+                   num_steps);
+        logger->info("Direct chunks, {:>4} threads: {:.1f} MB/s", num_threads, megabytes / time);
+        if (num_threads == max_threads) {
+            break;
+        }
+    }
+    sonata_set_num_compression_threads(1);
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
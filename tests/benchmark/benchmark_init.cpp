@@ -0,0 +1,76 @@
+/**
+ * \file
+ * \brief Cost of sonata_setup_communicators for 1, 2, 4, ... up to max_reports reports. Each
+ * report is on the ranks whose rank modulo num_rank_sets is the report modulo num_rank_sets, so
+ * that the reports have num_rank_sets different sets of ranks. Run it on many ranks to see the
+ * cost of the collectives.
+ *
+ * Usage: reports_benchmark_init [max_reports] [num_rank_sets]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#ifdef SONATA_REPORT_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <bbp/sonata/reports.h>
+#include <utils/logger.h>
+
+double run(int num_reports, int num_rank_sets, int rank, int run_index) {
+    double voltage = -65.0;
+    for (int report = 0; report < num_reports; ++report) {
+        if (report % num_rank_sets != rank % num_rank_sets) {
+            continue;
+        }
+        // New names at every run, the communicators of known reports being kept
+        const std::string report_name = "benchmark_init_" + std::to_string(run_index) + "_" +
+                                        std::to_string(report);
+        sonata_create_report(report_name.c_str(), 0.0, 1.0, 1.0, "mV", "soma");
+        sonata_add_node(report_name.c_str(), "All", 0, rank + 1);
+        sonata_add_element(report_name.c_str(), "All", rank + 1, 0, &voltage);
+    }
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+    auto start = std::chrono::steady_clock::now();
+    sonata_setup_communicators();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+#endif
+
+    sonata_clear();
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    int rank = 0;
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Init(nullptr, nullptr);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+    const int max_reports = argc > 1 ? std::atoi(argv[1]) : 64;
+    const int num_rank_sets = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1;
+
+    int run_index = 0;
+    for (int num_reports = 1;; num_reports = std::min(2 * num_reports, max_reports)) {
+        double time = run(num_reports, num_rank_sets, rank, run_index++);
+        if (rank == 0) {
+            logger->info("{:>4} report(s): {:.3f} ms", num_reports, time * 1e3);
+        }
+        if (num_reports == max_reports) {
+            break;
+        }
+    }
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * \file
+ * \brief Recording cost of a report whose nodes are shuffled in the simulator memory, with the
+ * nodes laid out by id (default) or by address.
+ *
+ * Usage: reports_benchmark_node_order [num_nodes] [elements_per_node] [num_steps]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef SONATA_REPORT_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <bbp/sonata/reports.h>
+#include <utils/logger.h>
+
+#include "perf_counter.h"
+
+struct Result {
+    double seconds_per_step;
+    uint64_t cache_misses_per_step;
+};
+
+Result run(const std::string& node_order,
+           std::vector<double>& voltages,
+           const std::vector<uint32_t>& node_blocks,
+           uint32_t elements_per_node,
+           int num_steps) {
+    const std::string report_name = "benchmark_node_order_" + node_order;
+    const char* population_name = "All";
+    const double dt = 1.0;
+    sonata_create_report(report_name.c_str(), 0.0, num_steps * dt, dt, "mV", "compartment");
+    for (uint64_t node_id = 1; node_id <= node_blocks.size(); ++node_id) {
+        sonata_add_node(report_name.c_str(), population_name, 0, node_id);
+        double* block = &voltages[node_blocks[node_id - 1] * elements_per_node];
+        for (uint32_t element_id = 0; element_id < elements_per_node; ++element_id) {
+            sonata_add_element(
+                report_name.c_str(), population_name, node_id, element_id, block + element_id);
+        }
+    }
+    // Keep every step in memory so that only the recording is measured
+    size_t buffer_size = voltages.size() * sizeof(float) * num_steps;
+    sonata_set_report_max_buffer_size_hint(report_name.c_str(), buffer_size / 1048576 + 1);
+    sonata_set_report_node_order(report_name.c_str(), node_order.c_str());
+    sonata_set_atomic_step(dt);
+    sonata_setup_communicators();
+    sonata_prepare_datasets();
+
+    PerfCounter counter;
+    counter.start();
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < num_steps; ++step) {
+        sonata_record_data(step);
+    }
+    auto end = std::chrono::steady_clock::now();
+    uint64_t cache_misses = counter.stop();
+
+    sonata_flush(num_steps * dt);
+    sonata_clear();
+    return {std::chrono::duration<double>(end - start).count() / num_steps,
+            cache_misses / num_steps};
+}
+
+int main(int argc, char* argv[]) {
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Init(nullptr, nullptr);
+#endif
+    const uint32_t num_nodes = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const uint32_t elements_per_node = argc > 2 ? std::atoi(argv[2]) : 4;
+    const int num_steps = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    // Node i owns the block node_blocks[i] of the voltage array
+    std::vector<double> voltages(static_cast<size_t>(num_nodes) * elements_per_node);
+    std::iota(voltages.begin(), voltages.end(), 0.0);
+    std::vector<uint32_t> node_blocks(num_nodes);
+    std::iota(node_blocks.begin(), node_blocks.end(), 0);
+    std::shuffle(node_blocks.begin(), node_blocks.end(), std::mt19937(42));
+
+    logger->info("{} nodes with {} elements each, {} steps",
+                 num_nodes,
+                 elements_per_node,
+                 num_steps);
+    for (const std::string node_order : {"by_id", "by_address"}) {
+        Result result = run(node_order, voltages, node_blocks, elements_per_node, num_steps);
+        if (PerfCounter().is_available()) {
+            logger->info("{:>10}: {:.3f} ms/step, {} cache misses/step",
+                         node_order,
+                         result.seconds_per_step * 1e3,
+                         result.cache_misses_per_step);
+        } else {
+            logger->info("{:>10}: {:.3f} ms/step (cache miss counter not available)",
+                         node_order,
+                         result.seconds_per_step * 1e3);
+        }
+    }
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * \file
+ * \brief Startup cost of reports with 1, 2, 4, ... up to max_populations populations, measured
+ * from sonata_setup_communicators to the end of sonata_prepare_datasets. Run it on many ranks to
+ * see the cost of the collectives.
+ *
+ * Usage: reports_benchmark_prepare [max_populations] [nodes_per_population] [num_reports]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef SONATA_REPORT_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <bbp/sonata/reports.h>
+#include <utils/logger.h>
+
+double run(int num_populations, uint32_t nodes_per_population, int num_reports, int rank) {
+    const double dt = 1.0;
+    std::vector<double> voltages(nodes_per_population, -65.0);
+    std::vector<uint64_t> node_ids(nodes_per_population);
+    for (int report = 0; report < num_reports; ++report) {
+        const std::string report_name = "benchmark_prepare_" + std::to_string(report);
+        sonata_create_report(report_name.c_str(), 0.0, 10 * dt, dt, "mV", "soma");
+        for (int population = 0; population < num_populations; ++population) {
+            const std::string population_name = "population_" + std::to_string(population);
+            // Every rank owns a different range of ids of each population
+            const uint64_t first_id = 1 + static_cast<uint64_t>(rank) * nodes_per_population;
+            for (uint32_t node = 0; node < nodes_per_population; ++node) {
+                node_ids[node] = first_id + node;
+            }
+            sonata_add_nodes(report_name.c_str(),
+                             population_name.c_str(),
+                             0,
+                             node_ids.data(),
+                             nodes_per_population);
+            for (uint32_t node = 0; node < nodes_per_population; ++node) {
+                sonata_add_element(report_name.c_str(),
+                                   population_name.c_str(),
+                                   node_ids[node],
+                                   0,
+                                   &voltages[node]);
+            }
+        }
+    }
+    sonata_set_atomic_step(dt);
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+    auto start = std::chrono::steady_clock::now();
+    sonata_setup_communicators();
+    sonata_prepare_datasets();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &seconds, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+#endif
+
+    sonata_flush(10 * dt);
+    sonata_clear();
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    int rank = 0;
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Init(nullptr, nullptr);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+    const int max_populations = argc > 1 ? std::atoi(argv[1]) : 64;
+    const uint32_t nodes_per_population = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int num_reports = argc > 3 ? std::atoi(argv[3]) : 1;
+
+    if (rank == 0) {
+        logger->info("{} report(s) with {} nodes per population and rank",
+                     num_reports,
+                     nodes_per_population);
+    }
+    for (int num_populations = 1;;
+         num_populations = std::min(2 * num_populations, max_populations)) {
+        double time = run(num_populations, nodes_per_population, num_reports, rank);
+        if (rank == 0) {
+            logger->info("{:>4} population(s): {:.3f} ms", num_populations, time * 1e3);
+        }
+        if (num_populations == max_populations) {
+            break;
+        }
+    }
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * \file
+ * \brief Time to sort the spikes of a rank by time and by id, with the packed key radix sort and
+ * with the two stable sorts of a permutation it replaces. The spikes are Poisson trains of
+ * num_nodes nodes firing at rate_hz over duration_ms, with times on a 0.025 ms grid.
+ *
+ * Usage: reports_benchmark_spike_sort [num_spikes] [num_nodes]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <utils/logger.h>
+#include <utils/spike_sort.h>
+
+// The sort before the packed keys, copying the spikes as the serial implementation did
+void permutation_sort(std::vector<double>& times,
+                      std::vector<uint64_t>& node_ids,
+                      const std::string& order_by) {
+    const std::vector<double> in_times(times);
+    const std::vector<uint64_t> in_node_ids(node_ids);
+    std::vector<uint64_t> perm(in_times.size());
+    std::iota(perm.begin(), perm.end(), 0);
+    auto by_time = [&](uint64_t i, uint64_t j) { return in_times[i] < in_times[j]; };
+    auto by_id = [&](uint64_t i, uint64_t j) { return in_node_ids[i] < in_node_ids[j]; };
+    if (order_by == "by_id") {
+        std::stable_sort(perm.begin(), perm.end(), by_time);
+        std::stable_sort(perm.begin(), perm.end(), by_id);
+    } else {
+        std::stable_sort(perm.begin(), perm.end(), by_id);
+        std::stable_sort(perm.begin(), perm.end(), by_time);
+    }
+    std::transform(perm.begin(), perm.end(), times.begin(), [&](uint64_t i) {
+        return in_times[i];
+    });
+    std::transform(perm.begin(), perm.end(), node_ids.begin(), [&](uint64_t i) {
+        return in_node_ids[i];
+    });
+}
+
+template <typename Sort>
+double run(Sort sort,
+           std::vector<double>& times,
+           std::vector<uint64_t>& node_ids,
+           const std::string& order_by) {
+    auto start = std::chrono::steady_clock::now();
+    sort(times, node_ids, order_by);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    const size_t num_spikes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const uint64_t num_nodes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+
+    // Spikes as recorded, in time order per step and in any order of nodes within a step
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<uint64_t> node(1, num_nodes);
+    std::exponential_distribution<double> interval(num_nodes / 100.0);
+    std::vector<double> times(num_spikes);
+    std::vector<uint64_t> node_ids(num_spikes);
+    double time = 0.0;
+    for (size_t i = 0; i < num_spikes; ++i) {
+        time += interval(generator);
+        times[i] = std::round(time / 0.025) * 0.025;
+        node_ids[i] = node(generator);
+    }
+    // Spikes gathered from other ranks come in blocks
+    for (size_t begin = 0; begin < num_spikes; begin += 4096) {
+        const size_t end = std::min(begin + 4096, num_spikes);
+        std::shuffle(node_ids.begin() + begin, node_ids.begin() + end, generator);
+    }
+
+    logger->info("{} spikes of {} nodes", num_spikes, num_nodes);
+    for (const std::string order_by : {"by_time", "by_id"}) {
+        std::vector<double> permutation_times(times);
+        std::vector<uint64_t> permutation_node_ids(node_ids);
+        const double permutation_seconds =
+            run(permutation_sort, permutation_times, permutation_node_ids, order_by);
+
+        std::vector<double> key_times(times);
+        std::vector<uint64_t> key_node_ids(node_ids);
+        const double key_seconds =
+            run(bbp::sonata::sort_spikes, key_times, key_node_ids, order_by);
+
+        const bool same = key_times == permutation_times && key_node_ids == permutation_node_ids;
+        logger->info("{:>8}: permutation {:.3f} s, packed keys {:.3f} s ({:.1f}x){}",
+                     order_by,
+                     permutation_seconds,
+                     key_seconds,
+                     permutation_seconds / key_seconds,
+                     same ? "" : ", DIFFERENT ORDER");
+        if (!same) {
+            return 1;
+        }
+    }
+    return 0;
+}
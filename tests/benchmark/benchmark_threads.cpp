@@ -0,0 +1,117 @@
+/**
+ * \file
+ * \brief Recording cost of a large report with 1, 2, 4, ... up to max_threads recording threads.
+ *
+ * Usage: reports_benchmark_threads [num_nodes] [elements_per_node] [num_steps] [max_threads]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SONATA_REPORT_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <bbp/sonata/reports.h>
+#include <utils/logger.h>
+
+double run(int num_threads,
+           std::vector<double>& voltages,
+           const std::vector<uint32_t>& node_blocks,
+           uint32_t elements_per_node,
+           int num_steps) {
+    const std::string report_name = "benchmark_threads_" + std::to_string(num_threads);
+    const char* population_name = "All";
+    const double dt = 1.0;
+    const uint64_t num_nodes = node_blocks.size();
+    sonata_create_report(report_name.c_str(), 0.0, num_steps * dt, dt, "mV", "compartment");
+
+    std::vector<uint64_t> node_ids(num_nodes);
+    std::iota(node_ids.begin(), node_ids.end(), 1);
+    std::vector<uint64_t> offsets(num_nodes + 1);
+    std::vector<uint32_t> element_ids(num_nodes * elements_per_node);
+    std::vector<double*> element_values(num_nodes * elements_per_node);
+    for (uint64_t node = 0; node < num_nodes; ++node) {
+        offsets[node + 1] = offsets[node] + elements_per_node;
+        for (uint32_t i = 0; i < elements_per_node; ++i) {
+            element_ids[offsets[node] + i] = i;
+            element_values[offsets[node] + i] =
+                &voltages[node_blocks[node] * elements_per_node + i];
+        }
+    }
+    sonata_add_nodes(report_name.c_str(), population_name, 0, node_ids.data(), num_nodes);
+    sonata_add_elements_bulk(report_name.c_str(),
+                             population_name,
+                             node_ids.data(),
+                             num_nodes,
+                             offsets.data(),
+                             element_ids.data(),
+                             element_values.data());
+
+    // Keep every step in memory so that only the recording is measured
+    size_t buffer_size = voltages.size() * sizeof(float) * num_steps;
+    sonata_set_report_max_buffer_size_hint(report_name.c_str(), buffer_size / 1048576 + 1);
+    sonata_set_num_threads(num_threads);
+    sonata_set_atomic_step(dt);
+    sonata_setup_communicators();
+    sonata_prepare_datasets();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < num_steps; ++step) {
+        sonata_record_data(step);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    sonata_flush(num_steps * dt);
+    sonata_clear();
+    return std::chrono::duration<double>(end - start).count() / num_steps;
+}
+
+int main(int argc, char* argv[]) {
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Init(nullptr, nullptr);
+#endif
+    const uint32_t num_nodes = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const uint32_t elements_per_node = argc > 2 ? std::atoi(argv[2]) : 20;
+    const int num_steps = argc > 3 ? std::atoi(argv[3]) : 20;
+    const int max_threads = argc > 4 ? std::atoi(argv[4])
+                                     : std::max(1u, std::thread::hardware_concurrency());
+
+    // Node i owns the block node_blocks[i] of the voltage array
+    std::vector<double> voltages(static_cast<size_t>(num_nodes) * elements_per_node);
+    std::iota(voltages.begin(), voltages.end(), 0.0);
+    std::vector<uint32_t> node_blocks(num_nodes);
+    std::iota(node_blocks.begin(), node_blocks.end(), 0);
+    std::shuffle(node_blocks.begin(), node_blocks.end(), std::mt19937(42));
+
+    logger->info("{} nodes with {} elements each, {} steps",
+                 num_nodes,
+                 elements_per_node,
+                 num_steps);
+    double serial_time = 0;
+    for (int num_threads = 1;; num_threads = std::min(2 * num_threads, max_threads)) {
+        double time = run(num_threads, voltages, node_blocks, elements_per_node, num_steps);
+        if (num_threads == 1) {
+            serial_time = time;
+        }
+        logger->info("{:>4} threads: {:.3f} ms/step, speedup {:.2f}",
+                     num_threads,
+                     time * 1e3,
+                     serial_time / time);
+        if (num_threads == max_threads) {
+            break;
+        }
+    }
+    sonata_set_num_threads(1);
+
+#ifdef SONATA_REPORT_HAVE_MPI
+    MPI_Finalize();
+#endif
+    return 0;
+}
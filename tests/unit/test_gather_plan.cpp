@@ -0,0 +1,210 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <limits>
+#include <data/array_registry.h>
+#include <data/gather_plan.h>
+#include <memory>
+#include <numeric>
+
+using namespace bbp::sonata;
+
+// Values of the elements of every node of a sealed table, in node order
+std::vector<float> read_all(const NodeTable& nodes) {
+    std::vector<float> values;
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        for (size_t i = nodes.get_element_begin(node); i < nodes.get_element_end(node); ++i) {
+            values.push_back(static_cast<float>(*nodes.get_element_address(node, i)));
+        }
+    }
+    return values;
+}
+
+std::vector<uint32_t> identity_order(const NodeTable& nodes) {
+    std::vector<uint32_t> order(nodes.size());
+    std::iota(order.begin(), order.end(), 0);
+    return order;
+}
+
+SCENARIO("Test GatherPlan class", "[GatherPlan]") {
+    GIVEN("Nodes whose elements are scattered in memory") {
+        std::vector<double> values(64);
+        std::iota(values.begin(), values.end(), 0.5);
+
+        NodeTable nodes;
+        nodes.add_node(1);
+        for (uint32_t i = 0; i < 13; ++i) {
+            nodes.add_element(1, &values[(i * 7) % values.size()], i);
+        }
+        nodes.add_node(2);
+        nodes.add_element(2, &values[63], 0);
+        nodes.add_element(2, &values[0], 1);
+        nodes.seal();
+
+        GatherPlan plan;
+        plan.build(nodes, identity_order(nodes));
+
+        THEN("The plan follows the node order") {
+            REQUIRE(plan.size() == 15);
+        }
+        THEN("Gathering a whole step converts every element") {
+            std::vector<float> result(plan.size(), -1);
+            plan.gather(0, plan.size(), result.data());
+            REQUIRE(result == read_all(nodes));
+        }
+        THEN("Gathering a range only converts that range") {
+            std::vector<float> result(2, -1);
+            plan.gather(13, 15, result.data());
+            REQUIRE(result == std::vector<float>{63.5, 0.5});
+        }
+    }
+
+    GIVEN("Nodes whose elements are positions of registered arrays") {
+        std::vector<double> voltages(20);
+        std::iota(voltages.begin(), voltages.end(), 0);
+        std::vector<double> currents = {-1, -2, -3};
+
+        ArrayRegistry arrays;
+        NodeTable nodes;
+        std::vector<uint32_t> indices = {3, 2, 1, 0, 19, 18, 17, 16, 15, 9};
+        std::vector<uint32_t> element_ids(indices.size(), 0);
+        const uint64_t node_ids[3] = {1, 2, 3};
+        nodes.add_nodes(node_ids, 3);
+        nodes.add_indexed_elements(
+            1, arrays.register_array(voltages.data()), indices.data(), element_ids.data(), 10);
+        nodes.add_indexed_elements(
+            2, arrays.register_array(currents.data()), indices.data() + 1, element_ids.data(), 2);
+        nodes.add_element(3, &voltages[5], 0);
+        nodes.seal();
+
+        GatherPlan plan;
+        plan.build(nodes, identity_order(nodes));
+
+        THEN("Gathering a whole step reads every array") {
+            std::vector<float> result(plan.size(), -1);
+            plan.gather(0, plan.size(), result.data());
+            REQUIRE(result == std::vector<float>{3, 2, 1, 0, 19, 18, 17, 16, 15, 9, -3, -2, 5});
+        }
+        THEN("A registered array can be moved without rebuilding the plan") {
+            std::vector<double> moved_voltages(voltages.rbegin(), voltages.rend());
+            REQUIRE(arrays.register_array(voltages.data()) ==
+                    arrays.register_array(voltages.data()));
+            REQUIRE(arrays.rebase_array(voltages.data(), moved_voltages.data()) == 1);
+            REQUIRE(arrays.rebase_array(voltages.data(), moved_voltages.data()) == 0);
+
+            std::vector<float> result(3, -1);
+            plan.gather(8, 11, result.data());
+            REQUIRE(result == std::vector<float>{4, 10, -3});
+        }
+    }
+
+    GIVEN("Nodes whose elements are mostly consecutive in memory") {
+        std::vector<double> values(100);
+        std::iota(values.begin(), values.end(), 0);
+
+        NodeTable nodes;
+        const uint64_t node_ids[4] = {1, 2, 3, 4};
+        nodes.add_nodes(node_ids, 4);
+        // Node 1 and 2 continue the same run, node 3 is scattered, node 4 starts a run midway
+        for (uint32_t i = 0; i < 10; ++i) {
+            nodes.add_element(1, &values[i], i);
+        }
+        for (uint32_t i = 10; i < 25; ++i) {
+            nodes.add_element(2, &values[i], i);
+        }
+        nodes.add_element(3, &values[90], 0);
+        nodes.add_element(3, &values[80], 1);
+        nodes.add_element(4, &values[70], 0);
+        for (uint32_t i = 40; i < 60; ++i) {
+            nodes.add_element(4, &values[i], i);
+        }
+        nodes.seal();
+
+        GatherPlan plan;
+        plan.build(nodes, identity_order(nodes));
+
+        const std::vector<float> compare = read_all(nodes);
+
+        THEN("The runs are split from the scattered elements") {
+            // [0, 25) contiguous, [25, 28) scattered, [28, 48) contiguous
+            REQUIRE(plan.size() == 48);
+            REQUIRE(plan.get_num_segments() == 3);
+        }
+        THEN("Gathering a whole step reads every element") {
+            std::vector<float> result(plan.size(), -1);
+            plan.gather(0, plan.size(), result.data());
+            REQUIRE(result == compare);
+        }
+        THEN("Gathering a node reads only its elements") {
+            std::vector<float> result(21, -1);
+            plan.gather_node(3, result.data());
+            REQUIRE(plan.get_node_begin(3) == 27);
+            REQUIRE(result == std::vector<float>(compare.begin() + 27, compare.end()));
+        }
+        THEN("Gathering ranges across runs reads every element") {
+            for (size_t begin = 0; begin < plan.size(); begin += 5) {
+                size_t end = std::min(begin + 13, plan.size());
+                std::vector<float> result(end - begin, -1);
+                plan.gather(begin, end, result.data());
+                REQUIRE(result ==
+                        std::vector<float>(compare.begin() + begin, compare.begin() + end));
+            }
+        }
+        THEN("Gathering a step quantized to integers rounds every element to the scale") {
+            plan.set_quantization(0.5, 10.0);
+            std::vector<int16_t> result(plan.size(), -1);
+            plan.gather(0, plan.size(), result.data());
+            std::vector<int16_t> expected;
+            for (float value : compare) {
+                expected.push_back(static_cast<int16_t>((value - 10) * 2));
+            }
+            REQUIRE(result == expected);
+        }
+        THEN("Gathering a step as doubles or halves reads every element") {
+            std::vector<double> doubles(plan.size(), -1);
+            plan.gather(0, plan.size(), doubles.data());
+            REQUIRE(std::vector<float>(doubles.begin(), doubles.end()) == compare);
+            std::vector<float16> halves(plan.size());
+            plan.gather(0, plan.size(), halves.data());
+            std::vector<float> decoded;
+            for (float16 half : halves) {
+                decoded.push_back(to_float(half));
+            }
+            // Integers up to 2048 are exact halves
+            REQUIRE(decoded == compare);
+        }
+    }
+
+    GIVEN("Values out of the range of the integers") {
+        const double nan = std::nan("");
+        const std::vector<double> values = {-1000, -128.5, -2.5, -1.5, 0.49, 126.6, 1000, nan, 3};
+        THEN("They are clamped symmetrically, rounded to the nearest even integer and NaN alone is "
+             "the lowest") {
+            std::vector<int8_t> result(values.size());
+            quantize(values.data(), values.size(), 1.0, 0.0, result.data());
+            REQUIRE(result == std::vector<int8_t>{-127, -127, -2, -2, 0, 127, 127, -128, 3});
+            // Through the vector and the scalar versions
+            std::vector<int16_t> shorts(values.size());
+            quantize(values.data(), values.size(), 0.01, 0.0, shorts.data());
+            REQUIRE(shorts == std::vector<int16_t>{
+                                  -32767, -12850, -250, -150, 49, 12660, 32767, -32768, 300});
+        }
+        THEN("Halves round to the nearest even, overflow to infinity and keep NaN") {
+            // 2049 and 2051 are ties between halves 2 apart, 2^-24 is the smallest subnormal
+            const double smallest = std::ldexp(1.0, -24);
+            const std::vector<double> floats = {2049, 2051, 65504, 65520, -1e6, 0.5, smallest};
+            std::vector<float16> halves(floats.size());
+            convert(floats.data(), floats.size(), halves.data());
+            std::vector<float> decoded;
+            for (float16 half : halves) {
+                decoded.push_back(to_float(half));
+            }
+            const float infinity = std::numeric_limits<float>::infinity();
+            const std::vector<float> expected = {
+                2048, 2052, 65504, infinity, -infinity, 0.5, static_cast<float>(smallest)};
+            REQUIRE(decoded == expected);
+            float16 half;
+            convert(&nan, 1, &half);
+            REQUIRE(std::isnan(to_float(half)));
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#include <catch2/catch.hpp>
+#include <utils/name_table.h>
+
+using namespace bbp::sonata;
+
+SCENARIO("Test NameTable class", "[NameTable]") {
+    GIVEN("A table with two names") {
+        NameTable table;
+        REQUIRE(table.intern("NodeA") == 0);
+        REQUIRE(table.intern("NodeB") == 1);
+        THEN("Names keep their ids when interned again") {
+            REQUIRE(table.intern("NodeA") == 0);
+            REQUIRE(table.size() == 2);
+        }
+        THEN("Ids map back to their names") {
+            REQUIRE(table.get_name(1) == "NodeB");
+            REQUIRE(table.find("NodeB") == 1);
+        }
+        THEN("Unknown names are not found") {
+            REQUIRE(table.find("NodeC") == NameTable::npos);
+            REQUIRE_THROWS(table.get_name(2));
+        }
+        WHEN("A new name is interned") {
+            THEN("It gets the next id") {
+                REQUIRE(table.intern("NodeC") == 2);
+                REQUIRE(table.size() == 3);
+            }
+        }
+    }
+}
@@ -0,0 +1,239 @@
+#include <catch2/catch.hpp>
+#include <data/node_table.h>
+#include <memory>
+#include <spdlog/spdlog.h>
+
+using namespace bbp::sonata;
+
+double* square(double* elem) {
+    *elem *= *elem;
+    return elem;
+}
+
+std::vector<double> read_values(const NodeTable& nodes, size_t node) {
+    std::vector<double> values;
+    for (size_t i = nodes.get_element_begin(node); i < nodes.get_element_end(node); ++i) {
+        values.push_back(*nodes.get_element_address(node, i));
+    }
+    return values;
+}
+
+SCENARIO("Test NodeTable class", "[NodeTable]") {
+    GIVEN("An instance of a NodeTable") {
+        NodeTable nodes;
+        {  // Initial conditions
+            REQUIRE(nodes.empty());
+            REQUIRE(nodes.get_num_elements() == 0);
+            REQUIRE_NOTHROW(nodes.refresh_pointers(&square));
+        }
+
+        WHEN("We add nodes in any order and their elements interleaved") {
+            std::vector<double> elements = {10, 11, 12, 13, 14};
+            nodes.add_node(7);
+            nodes.add_node(3);
+            nodes.add_element(7, &elements[0], 0);
+            nodes.add_element(3, &elements[1], 5);
+            nodes.add_element(7, &elements[2], 1);
+            nodes.add_element(7, &elements[3], 2);
+            nodes.add_element(3, &elements[4], 6);
+
+            THEN("Number of nodes is 2 and number of elements is 5") {
+                REQUIRE(nodes.size() == 2);
+                REQUIRE(nodes.get_num_elements() == 5);
+                REQUIRE(nodes.contains(3));
+                REQUIRE(!nodes.contains(4));
+            }
+            THEN("Adding an existing node or to a missing node throws") {
+                REQUIRE_THROWS(nodes.add_node(3));
+                REQUIRE_THROWS_AS(nodes.add_element(4, &elements[0], 0), std::out_of_range);
+                REQUIRE(nodes.size() == 2);
+            }
+            THEN("Sealing sorts the nodes by id and keeps the order of their elements") {
+                nodes.seal();
+                REQUIRE(nodes.is_sealed());
+                REQUIRE(nodes.get_node_id(0) == 3);
+                REQUIRE(nodes.get_node_id(1) == 7);
+                REQUIRE(nodes.get_element_begin(1) == 2);
+                REQUIRE(nodes.get_num_elements(1) == 3);
+                REQUIRE(read_values(nodes, 0) == std::vector<double>{11, 14});
+                REQUIRE(read_values(nodes, 1) == std::vector<double>{10, 12, 13});
+                REQUIRE(std::vector<uint32_t>(nodes.get_element_ids(),
+                                              nodes.get_element_ids() + 5) ==
+                        std::vector<uint32_t>{5, 6, 0, 1, 2});
+                REQUIRE(nodes.find(7) == 1);
+                REQUIRE(nodes.find(8) == NodeTable::npos);
+                REQUIRE(nodes.contains(7));
+                REQUIRE_THROWS(nodes.add_node(8));
+                REQUIRE_THROWS(nodes.add_element(3, &elements[0], 7));
+            }
+            THEN("refresh_pointers will be call on all elements, before or after sealing") {
+                nodes.refresh_pointers(&square);
+                nodes.seal();
+                REQUIRE(read_values(nodes, 0) == std::vector<double>{121, 196});
+                nodes.refresh_pointers(&square);
+                REQUIRE(read_values(nodes, 1) == std::vector<double>{10000, 20736, 28561});
+            }
+        }
+
+        WHEN("We add nodes and elements in bulk") {
+            std::vector<double> values = {1, 2, 3, 4};
+            const std::vector<uint64_t> node_ids = {1, 2, 3};
+            const std::vector<uint64_t> offsets = {0, 1, 1, 4};
+            const std::vector<uint32_t> element_ids = {0, 0, 1, 2};
+            const std::vector<double*> element_values = {
+                &values[0], &values[1], &values[2], &values[3]};
+            nodes.add_nodes(node_ids.data(), node_ids.size());
+            nodes.add_elements(node_ids.data(),
+                               node_ids.size(),
+                               offsets.data(),
+                               element_ids.data(),
+                               element_values.data());
+            nodes.seal();
+            THEN("Every node gets its own range of elements") {
+                REQUIRE(nodes.get_num_elements() == 4);
+                REQUIRE(read_values(nodes, 0) == std::vector<double>{1});
+                REQUIRE(nodes.get_num_elements(1) == 0);
+                REQUIRE(read_values(nodes, 2) == std::vector<double>{2, 3, 4});
+            }
+        }
+    }
+
+    GIVEN("A node with elements registered as positions of an array") {
+        NodeTable nodes;
+        std::vector<double> values = {10, 11, 12, 13, 14};
+        const double* base = values.data();
+        std::vector<uint32_t> indices = {4, 0, 2};
+        std::vector<uint32_t> element_ids = {7, 8, 9};
+        double element = 1;
+        nodes.add_node(1);
+        nodes.add_node(2);
+        nodes.add_indexed_elements(1, &base, indices.data(), element_ids.data(), indices.size());
+        nodes.add_element(2, &element, 0);
+
+        THEN("Number of elements is 4") {
+            REQUIRE(nodes.get_num_elements() == 4);
+        }
+        THEN("The values are read through the array") {
+            nodes.seal();
+            REQUIRE(nodes.get_base(0) == &base);
+            REQUIRE(nodes.get_base(1) == nullptr);
+            REQUIRE(nodes.get_indices()[nodes.get_source_begin(0) + 1] == 0);
+            REQUIRE(read_values(nodes, 0) == std::vector<double>{14, 10, 12});
+            REQUIRE(read_values(nodes, 1) == std::vector<double>{1});
+        }
+        THEN("Pointers or other arrays can't be mixed in") {
+            const double* other_base = &element;
+            REQUIRE_THROWS(nodes.add_element(1, &element, 10));
+            REQUIRE_THROWS(
+                nodes.add_indexed_elements(1, &other_base, indices.data(), element_ids.data(), 1));
+            REQUIRE_THROWS(
+                nodes.add_indexed_elements(2, &base, indices.data(), element_ids.data(), 1));
+            REQUIRE(nodes.get_num_elements() == 4);
+        }
+    }
+
+    GIVEN("Many nodes alternating pointers and indexed elements, added in decreasing order") {
+        auto arena = std::make_shared<Arena>();
+        NodeTable nodes(NodeTable::unlimited, arena);
+        const uint64_t num_nodes = 100;
+        std::vector<double> values(2 * num_nodes);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<double>(i);
+        }
+        const double* base = values.data();
+        for (uint64_t node_id = num_nodes; node_id-- > 0;) {
+            nodes.add_node(node_id);
+            const uint32_t indices[2] = {static_cast<uint32_t>(2 * node_id),
+                                         static_cast<uint32_t>(2 * node_id + 1)};
+            const uint32_t element_ids[2] = {0, 1};
+            if (node_id % 2 == 0) {
+                nodes.add_indexed_elements(node_id, &base, indices, element_ids, 2);
+            } else {
+                nodes.add_element(node_id, &values[indices[0]], 0);
+                nodes.add_element(node_id, &values[indices[1]], 1);
+            }
+        }
+        REQUIRE_THROWS(nodes.add_node(42));
+        nodes.seal();
+
+        THEN("Every node reads its own values") {
+            for (size_t node = 0; node < num_nodes; ++node) {
+                REQUIRE(nodes.get_node_id(node) == node);
+                REQUIRE(read_values(nodes, node) ==
+                        std::vector<double>{2.0 * node, 2.0 * node + 1});
+            }
+        }
+        THEN("Indexed elements only store their position") {
+            // node id, 2 offsets, base and source offset per node, pointer or index and element id
+            // per element
+            REQUIRE(arena->get_allocated_bytes() ==
+                    num_nodes * (sizeof(uint64_t) * 3 + sizeof(double*)) + sizeof(uint64_t) +
+                        num_nodes * (sizeof(double*) + sizeof(uint32_t) * 3));
+        }
+    }
+
+    GIVEN("A NodeTable of a soma report") {
+        auto arena = std::make_shared<Arena>();
+        NodeTable nodes(1, arena);
+        nodes.add_node(1);
+        WHEN("We add one element") {
+            double elem1 = 1;
+            nodes.add_element(1, &elem1, 1);
+
+            THEN("Number of elements is 1") {
+                REQUIRE(nodes.get_num_elements() == 1);
+            }
+            THEN("Adding an other element throw") {
+                REQUIRE_THROWS(nodes.add_element(1, &elem1, 2));
+                REQUIRE(nodes.get_num_elements() == 1);
+            }
+            THEN("Adding an other indexed element throw") {
+                const double* base = &elem1;
+                uint32_t index = 0;
+                REQUIRE_THROWS(nodes.add_indexed_elements(1, &base, &index, &index, 1));
+                REQUIRE(nodes.get_num_elements() == 1);
+            }
+            THEN("Sealing allocates the arrays from the arena") {
+                nodes.seal();
+                // node id, 2 offsets, base, source offset, pointer and element id
+                REQUIRE(arena->get_allocated_bytes() ==
+                        sizeof(uint64_t) * 4 + sizeof(double*) * 2 + sizeof(uint32_t));
+            }
+        }
+    }
+
+    GIVEN("A NodeTable of a summation report") {
+        NodeTable nodes(NodeTable::unlimited, std::make_shared<Arena>(), true);
+        nodes.add_node(1);
+        std::vector<double> values{1, 2, 3, 4};
+        WHEN("We add weighted elements with unsorted ids") {
+            nodes.add_element(1, &values[0], 2);
+            nodes.add_weighted_element(1, &values[1], 0, 0.5);
+            nodes.add_element(1, &values[2], 2);
+            nodes.add_weighted_element(1, &values[3], 1, 2.0);
+            nodes.seal();
+            THEN("The elements are sorted by id, keeping their order for equal ids") {
+                REQUIRE(std::vector<uint32_t>(nodes.get_element_ids(),
+                                              nodes.get_element_ids() + 4) ==
+                        std::vector<uint32_t>{0, 1, 2, 2});
+                REQUIRE(read_values(nodes, 0) == std::vector<double>{2, 4, 1, 3});
+            }
+            THEN("The weights follow their elements, unweighted ones counting as 1") {
+                REQUIRE(nodes.has_weights());
+                std::vector<double> weights;
+                for (size_t i = 0; i < 4; ++i) {
+                    weights.push_back(nodes.get_weight(i));
+                }
+                REQUIRE(weights == std::vector<double>{0.5, 2.0, 1.0, 1.0});
+            }
+        }
+        WHEN("We add elements without weights") {
+            nodes.add_element(1, &values[0], 0);
+            nodes.seal();
+            THEN("No weight is stored") {
+                REQUIRE_FALSE(nodes.has_weights());
+                REQUIRE(nodes.get_weight(0) == 1.0);
+            }
+        }
+    }
+}
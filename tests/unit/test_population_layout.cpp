@@ -0,0 +1,63 @@
+#include <catch2/catch.hpp>
+#include <io/population_layout.h>
+#include <vector>
+
+using namespace bbp::sonata;
+
+SCENARIO("Test PopulationLayout class", "[PopulationLayout]") {
+    GIVEN("The counts of 4 ranks, the last of them without elements") {
+        // elements, nodes, max steps to write
+        const std::vector<uint64_t> counts = {6, 2, 100, 0, 0, UINT32_MAX, 9, 3, 50, 0, 0, 80};
+        WHEN("We compute the layout of the third rank") {
+            PopulationLayout layout(counts, 2);
+            THEN("Its parts follow the ones of the previous ranks") {
+                REQUIRE(layout.get_elements().offset == 6);
+                REQUIRE(layout.get_elements().global_size == 15);
+                REQUIRE(layout.get_nodes().offset == 2);
+                REQUIRE(layout.get_nodes().global_size == 5);
+                REQUIRE(layout.get_index_pointers().offset == 2);
+                REQUIRE(layout.get_index_pointers().global_size == 6);
+                REQUIRE(layout.get_max_rank_elements() == 9);
+            }
+            THEN("It writes the last index pointer and every rank buffers the same steps") {
+                REQUIRE(layout.is_last_writer());
+                REQUIRE(layout.get_max_steps_to_write() == 50);
+            }
+        }
+        WHEN("We compute the layout of the rank after it") {
+            PopulationLayout layout(counts, 3);
+            THEN("Its parts are empty and at the end of the datasets") {
+                REQUIRE_FALSE(layout.is_last_writer());
+                REQUIRE(layout.get_elements().offset == 15);
+                REQUIRE(layout.get_index_pointers().offset == 6);
+            }
+        }
+    }
+    GIVEN("The counts of 2 populations exchanged together by 2 ranks") {
+        // The first rank has both populations, the second one only the last
+        const std::vector<uint64_t> counts = {4, 1, 10, 2, 2, 20, 0, 0, UINT32_MAX, 6, 3, 5};
+        WHEN("We compute the layouts of the second rank") {
+            const auto layouts = PopulationLayout::from_counts(counts, 2, 1);
+            THEN("Each population is laid out as if exchanged on its own") {
+                REQUIRE(layouts.size() == 2);
+                REQUIRE_FALSE(layouts[0].is_last_writer());
+                REQUIRE(layouts[0].get_elements().offset == 4);
+                REQUIRE(layouts[0].get_elements().global_size == 4);
+                REQUIRE(layouts[0].get_max_steps_to_write() == 10);
+                REQUIRE(layouts[1].is_last_writer());
+                REQUIRE(layouts[1].get_nodes().offset == 2);
+                REQUIRE(layouts[1].get_index_pointers().global_size == 6);
+                REQUIRE(layouts[1].get_max_steps_to_write() == 5);
+            }
+        }
+    }
+    GIVEN("The counts of ranks without any element") {
+        const std::vector<uint64_t> counts = {0, 0, UINT32_MAX, 0, 0, UINT32_MAX};
+        THEN("No rank writes the last index pointer") {
+            PopulationLayout layout(counts, 0);
+            REQUIRE_FALSE(layout.is_last_writer());
+            REQUIRE(layout.get_index_pointers().global_size == 0);
+            REQUIRE(layout.get_max_steps_to_write() == UINT32_MAX);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#include <catch2/catch.hpp>
+#include <utils/rank_sets.h>
+#include <vector>
+
+using namespace bbp::sonata;
+
+SCENARIO("Test RankSets class", "[RankSets]") {
+    GIVEN("The reports of 4 ranks") {
+        // Reports 0 and 2 are on ranks 0 and 3, report 1 on every rank, report 3 on rank 3 only
+        const std::vector<std::vector<size_t>> rank_reports = {{0, 1, 2}, {1}, {1}, {0, 1, 2, 3}};
+        const size_t num_reports = 4;
+        std::vector<uint64_t> bitmaps;
+        for (const auto& reports : rank_reports) {
+            std::vector<uint64_t> bitmap(RankSets::get_num_words(num_reports));
+            for (size_t report : reports) {
+                RankSets::add_report(bitmap, report);
+            }
+            bitmaps.insert(bitmaps.end(), bitmap.begin(), bitmap.end());
+        }
+        RankSets rank_sets(bitmaps, num_reports);
+        THEN("Reports with the same ranks share the first of them as leader") {
+            REQUIRE(rank_sets.get_leader(0) == 0);
+            REQUIRE(rank_sets.get_leader(1) == 1);
+            REQUIRE(rank_sets.get_leader(2) == 0);
+            REQUIRE(rank_sets.get_leader(3) == 3);
+        }
+        THEN("The ranks of each report are listed in order") {
+            REQUIRE(rank_sets.get_ranks(0) == std::vector<int>{0, 3});
+            REQUIRE(rank_sets.get_ranks(1) == std::vector<int>{0, 1, 2, 3});
+            REQUIRE(rank_sets.get_ranks(3) == std::vector<int>{3});
+            REQUIRE(rank_sets.has_rank(2, 3));
+            REQUIRE_FALSE(rank_sets.has_rank(2, 1));
+        }
+    }
+    GIVEN("More reports than bits in a word") {
+        const size_t num_reports = 70;
+        // Two ranks, the second one having the reports 64 and 69 only
+        std::vector<uint64_t> bitmaps(2 * RankSets::get_num_words(num_reports), 0);
+        std::vector<uint64_t> bitmap(RankSets::get_num_words(num_reports));
+        RankSets::add_report(bitmap, 64);
+        RankSets::add_report(bitmap, 69);
+        std::copy(bitmap.begin(), bitmap.end(), bitmaps.begin() + bitmap.size());
+        RankSets rank_sets(bitmaps, num_reports);
+        THEN("The reports of the second word are found") {
+            REQUIRE(bitmap.size() == 2);
+            REQUIRE(rank_sets.get_ranks(69) == std::vector<int>{1});
+            REQUIRE(rank_sets.get_leader(69) == 64);
+            REQUIRE(rank_sets.get_leader(65) == 0);
+        }
+    }
+}
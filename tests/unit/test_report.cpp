@@ -3,6 +3,7 @@
 #include <library/element_report.h>
 #include <library/report.h>
 #include <library/soma_report.h>
+#include <library/summation_report.h>
 #include <memory>
 
 using namespace bbp::sonata;
@@ -27,8 +28,8 @@ SCENARIO("Test Report class", "[Report]") {
         WHEN("We add a node and a variable to a soma report") {
             soma_report->add_node(population_name, population_offset, 1);
             double element_value = 10;
-            std::shared_ptr<Node> node = soma_report->get_node(population_name, 1);
-            node->add_element(&element_value, soma_id);
+            std::shared_ptr<NodeTable> nodes = soma_report->get_population(population_name);
+            nodes->add_element(1, &element_value, soma_id);
             THEN("Number of nodes and elements is 1") {
                 REQUIRE(soma_report->get_num_nodes(population_name) == 1);
                 REQUIRE(soma_report->get_total_elements(population_name) == 1);
@@ -40,14 +41,39 @@ SCENARIO("Test Report class", "[Report]") {
         WHEN("We add 2 elements to a given node in a soma report") {
             soma_report->add_node(population_name, population_offset, 1);
             double element_value = 42;
-            soma_report->get_node(population_name, 1)->add_element(&element_value, soma_id);
-            REQUIRE_THROWS(
-                soma_report->get_node(population_name, 1)->add_element(&element_value, soma_id));
+            soma_report->get_population(population_name)->add_element(1, &element_value, soma_id);
+            REQUIRE_THROWS(soma_report->get_population(population_name)
+                               ->add_element(1, &element_value, soma_id));
             THEN("Number of nodes and elements is still 1") {
                 REQUIRE(soma_report->get_num_nodes(population_name) == 1);
                 REQUIRE(soma_report->get_total_elements(population_name) == 1);
             }
         }
+        WHEN("We add elements in bulk to a soma report") {
+            const std::array<uint64_t, 2> node_ids{1, 2};
+            const std::array<uint64_t, 3> offsets{0, 1, 3};
+            double element_value = 42;
+            const std::array<double*, 3> element_values{
+                &element_value, &element_value, &element_value};
+            const std::array<uint32_t, 3> element_ids{soma_id, soma_id, soma_id};
+            soma_report->add_nodes(
+                population_name, population_offset, node_ids.data(), node_ids.size());
+            THEN("Nodes with more than 1 element are rejected") {
+                REQUIRE_NOTHROW(soma_report->add_elements(population_name,
+                                                          node_ids.data(),
+                                                          1,
+                                                          offsets.data(),
+                                                          element_ids.data(),
+                                                          element_values.data()));
+                REQUIRE_THROWS(soma_report->add_elements(population_name,
+                                                         node_ids.data() + 1,
+                                                         1,
+                                                         offsets.data() + 1,
+                                                         element_ids.data(),
+                                                         element_values.data()));
+                REQUIRE(soma_report->get_total_elements(population_name) == 1);
+            }
+        }
         WHEN("We add the same node twice in the same population") {
             soma_report->add_node(population_name, population_offset, 1);
             REQUIRE_THROWS(soma_report->add_node(population_name, population_offset, 1));
@@ -86,17 +112,16 @@ SCENARIO("Test Report class", "[Report]") {
             element_report->add_node(population_name, population_offset, 1);
             element_report->add_node(population_name, population_offset, 2);
             double element_value = 10;
-            element_report->get_node(population_name, 1)->add_element(&element_value, element_id);
+            std::shared_ptr<NodeTable> nodes = element_report->get_population(population_name);
+            nodes->add_element(1, &element_value, element_id);
 
             std::array<double, 9> elements{1, 20, 300, 4000, 500, 60, 7, 0.8, 9};
             for (auto element_value : elements) {
-                element_report->get_node(population_name, 2)
-                    ->add_element(&element_value, element_id);
+                nodes->add_element(2, &element_value, element_id);
             }
 
             // Doesn't exists
-            REQUIRE_THROWS(element_report->get_node(population_name, 3)
-                               ->add_element(&element_value, element_id));
+            REQUIRE_THROWS(nodes->add_element(3, &element_value, element_id));
             THEN("Number of nodes is 2") {
                 REQUIRE(element_report->get_num_nodes(population_name) == 2);
             }
@@ -104,5 +129,81 @@ SCENARIO("Test Report class", "[Report]") {
                 REQUIRE(element_report->get_total_elements(population_name) == 10);
             }
         }
+
+        WHEN("We add nodes and elements in bulk") {
+            const std::array<uint64_t, 4> node_ids{2, 3, 5, 4};
+            const std::array<uint64_t, 5> offsets{0, 3, 3, 4, 6};
+            std::array<double, 6> values{1, 2, 3, 4, 5, 6};
+            std::array<double*, 6> element_values{
+                &values[0], &values[1], &values[2], &values[3], &values[4], &values[5]};
+            const std::array<uint32_t, 6> element_ids{0, 1, 2, 0, 0, 1};
+            element_report->add_node(population_name, population_offset, 1);
+            element_report->add_nodes(
+                population_name, population_offset, node_ids.data(), node_ids.size());
+            element_report->add_elements(population_name,
+                                         node_ids.data(),
+                                         node_ids.size(),
+                                         offsets.data(),
+                                         element_ids.data(),
+                                         element_values.data());
+            THEN("Every node gets its own range of elements") {
+                REQUIRE(element_report->get_num_nodes(population_name) == 5);
+                REQUIRE(element_report->get_total_elements(population_name) == 6);
+                std::shared_ptr<NodeTable> nodes = element_report->get_population(population_name);
+                nodes->seal();
+                REQUIRE(nodes->get_element_begin(1) == 0);
+                REQUIRE(std::vector<uint32_t>(nodes->get_element_ids(),
+                                              nodes->get_element_ids() + 3) ==
+                        std::vector<uint32_t>{0, 1, 2});
+                REQUIRE(nodes->get_num_elements(2) == 0);
+                REQUIRE(nodes->get_element_begin(3) == 3);
+                REQUIRE(nodes->get_element_address(3, 3) == &values[4]);
+                REQUIRE(nodes->get_element_address(3, 4) == &values[5]);
+            }
+            THEN("Existing nodes can't be added again and missing nodes get no elements") {
+                const uint64_t duplicated_ids[2] = {6, 3};
+                REQUIRE_THROWS(element_report->add_nodes(
+                    population_name, population_offset, duplicated_ids, 2));
+                REQUIRE(element_report->get_num_nodes(population_name) == 6);
+                const uint64_t missing_ids[1] = {7};
+                REQUIRE_THROWS_AS(element_report->add_elements(population_name,
+                                                               missing_ids,
+                                                               1,
+                                                               offsets.data(),
+                                                               element_ids.data(),
+                                                               element_values.data()),
+                                  std::out_of_range);
+            }
+        }
+    }
+    GIVEN("An instance of a summation report") {
+        std::shared_ptr<Report> summation_report =
+            std::make_shared<SummationReport>("summationReport", 0.0, 1.0, 0.1, report_units);
+        summation_report->add_node(population_name, population_offset, 2);
+        summation_report->add_node(population_name, population_offset, 1);
+        std::shared_ptr<NodeTable> nodes = summation_report->get_population(population_name);
+        std::array<double, 4> values{1, 2, 3, 4};
+        nodes->add_element(2, &values[0], 5);
+        nodes->add_element(1, &values[1], 3);
+        nodes->add_element(2, &values[2], 4);
+        nodes->add_element(2, &values[3], 5);
+        WHEN("We count the columns before preparing the report") {
+            const size_t by_element = summation_report->get_total_elements(population_name);
+            summation_report->set_summation("node");
+            const size_t by_node = summation_report->get_total_elements(population_name);
+            THEN("Elements with the same id share a column and the population is still open") {
+                REQUIRE(by_element == 3);
+                REQUIRE(by_node == 2);
+                REQUIRE(!nodes->is_sealed());
+                nodes->add_element(1, &values[0], 6);
+                summation_report->add_node(population_name, population_offset, 3);
+                REQUIRE(summation_report->get_total_elements(population_name) == 2);
+            }
+            THEN("The count is the same once the population is sealed") {
+                summation_report->set_summation("element");
+                nodes->seal();
+                REQUIRE(summation_report->get_total_elements(population_name) == 3);
+            }
+        }
     }
 }
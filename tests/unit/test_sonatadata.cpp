@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <bbp/sonata/reports.h>
 #include <catch2/catch.hpp>
+#include <cmath>
 #include <data/sonata_data.h>
 #include <iostream>
 #include <library/implementation_interface.hpp>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <thread>
 #ifdef SONATA_REPORT_HAVE_MPI
 #include <mpi.h>
 #endif
@@ -15,32 +20,29 @@ static const std::string report_units = "nA";
 static const uint64_t population_offset = 100;
 
 SCENARIO("Test SonataData class", "[SonataData][IOWriter]") {
-    GIVEN("A node map structure") {
+    GIVEN("A node table") {
         double dt = 1.0;
         double tstart = 0.0;
         double tend = 3.0;
         sonata_set_atomic_step(dt);
-        using nodes_t = std::map<uint64_t, std::shared_ptr<Node>>;
-        auto node = std::make_shared<Node>(101);
+        auto nodes = std::make_shared<NodeTable>();
+        nodes->add_node(101);
         double element = 10;
         double element2 = 12;
-        node->add_element(&element, 0);
-        node->add_element(&element2, 1);
-        auto node2 = std::make_shared<Node>(102);
-        node2->add_element(&element, 10);
-        node2->add_element(&element2, 11);
-        node2->add_element(&element2, 12);
-        auto node42 = std::make_shared<Node>(142);
+        nodes->add_element(101, &element, 0);
+        nodes->add_element(101, &element2, 1);
+        nodes->add_node(102);
+        nodes->add_element(102, &element, 10);
+        nodes->add_element(102, &element2, 11);
+        nodes->add_element(102, &element2, 12);
+        nodes->add_node(142);
         std::vector<double> elements{34.1, 55.21, 3.141592, 44, 2124, 42.42};
         int i = 20;
         for (double& elem : elements) {
-            node42->add_element(&elem, i);
+            nodes->add_element(142, &elem, i);
             ++i;
         }
         WHEN("We record some data and prepare the dataset for a big enough max buffer size") {
-            auto nodes = std::make_shared<nodes_t>(std::initializer_list<nodes_t::value_type>{
-                {101, node}, {102, node2}, {142, node42}});
-
             int num_steps = 3;
             size_t max_buffer_size = 1024;
             std::string report_name = "test_sonatadata";
@@ -103,8 +105,6 @@ SCENARIO("Test SonataData class", "[SonataData][IOWriter]") {
             }
         }
         WHEN("We record some other data and prepare the dataset for a small max buffer size") {
-            auto nodes = std::make_shared<nodes_t>(std::initializer_list<nodes_t::value_type>{
-                {101, node}, {102, node2}, {142, node42}});
             int num_steps = 3;
             size_t max_buffer_size = 128;
             std::string report_name = "test_sonatadata2";
@@ -138,6 +138,901 @@ SCENARIO("Test SonataData class", "[SonataData][IOWriter]") {
             }
         }
     }
+    GIVEN("Nodes registered in the reverse order of their elements in memory") {
+        double dt = 1.0;
+        double tstart = 0.0;
+        double tend = 2.0;
+        sonata_set_atomic_step(dt);
+        std::vector<double> voltages{1, 2, 3, 4, 5, 6};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node_id = 1; node_id <= 3; ++node_id) {
+            nodes->add_node(node_id);
+            nodes->add_element(node_id, &voltages[6 - 2 * node_id], 0);
+            nodes->add_element(node_id, &voltages[7 - 2 * node_id], 1);
+        }
+        WHEN("We prepare the dataset ordering the nodes by address") {
+            int num_steps = 2;
+            std::string report_name = "test_sonatadata_by_address";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1024,
+                                                       num_steps,
+                                                       dt,
+                                                       tstart,
+                                                       tend,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_node_order("by_address");
+            sonata->prepare_dataset();
+            sonata->record_data(0, {2});
+            sonata->record_data(0, {1, 3});
+            sonata->check_and_write(0);
+            sonata->record_data(1);
+
+            THEN("The mapping follows the memory order") {
+                REQUIRE(sonata->get_node_ids() == std::vector<uint64_t>{3, 2, 1});
+                REQUIRE(sonata->get_index_pointers() == std::vector<uint64_t>{0, 2, 4, 6});
+            }
+            THEN("The buffer holds the elements in memory order") {
+                report_buffer_t compare{1, 2, 3, 4, 5, 6, 1, 2, 3, 4, 5, 6};
+                REQUIRE(sonata->get_report_buffer() == compare);
+            }
+            sonata->close();
+            H5Fclose(file_handler);
+        }
+    }
+    GIVEN("Nodes with sparse ids") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        std::vector<double> voltages{-65, -70, -75};
+        const std::vector<uint64_t> ids{5, 4000000000, 77777};
+        auto nodes = std::make_shared<NodeTable>();
+        for (size_t i = 0; i < ids.size(); ++i) {
+            nodes->add_node(ids[i]);
+            nodes->add_element(ids[i], &voltages[i], 0);
+        }
+        WHEN("We record the nodes in several calls") {
+            std::string report_name = "test_sonatadata_sparse";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1024,
+                                                       1,
+                                                       dt,
+                                                       0.0,
+                                                       1.0,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            // Ids of other populations are ignored
+            sonata->record_data(0, {4000000000, 6, 1});
+            sonata->record_data(0, {77777, 5});
+
+            THEN("Every node is recorded at its place in the buffer") {
+                REQUIRE(sonata->get_report_buffer() == report_buffer_t{-65, -75, -70});
+            }
+            sonata->check_and_write(0);
+            sonata->close();
+            H5Fclose(file_handler);
+        }
+    }
+    GIVEN("A population large enough to be recorded by several threads") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        const uint64_t num_nodes = 5000;
+        const uint32_t elements_per_node = 9;
+        std::vector<double> voltages(num_nodes * elements_per_node);
+        std::iota(voltages.begin(), voltages.end(), 0.0);
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < num_nodes; ++node) {
+            const uint64_t node_id = population_offset + 1 + node;
+            nodes->add_node(node_id);
+            for (uint32_t i = 0; i < elements_per_node; ++i) {
+                // Scatter the elements so that the gathers cross node boundaries
+                nodes->add_element(node_id, &voltages[i * num_nodes + node], i);
+            }
+        }
+        WHEN("We record two steps with 3 threads") {
+            sonata_set_num_threads(3);
+            std::string report_name = "test_sonatadata_threads";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1 << 20,
+                                                       2,
+                                                       dt,
+                                                       0.0,
+                                                       2.0,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            sonata->record_data(0);
+            std::transform(voltages.begin(), voltages.end(), voltages.begin(), [](double v) {
+                return -v;
+            });
+            sonata->record_data(1);
+            sonata_set_num_threads(1);
+
+            THEN("Every element is recorded once per step at its place in the buffer") {
+                const report_buffer_t& buffer = sonata->get_report_buffer();
+                const size_t step_size = num_nodes * elements_per_node;
+                REQUIRE(buffer.size() == 2 * step_size);
+                bool all_equal = true;
+                for (size_t node = 0; node < num_nodes; ++node) {
+                    for (size_t i = 0; i < elements_per_node; ++i) {
+                        const float value = static_cast<float>(i * num_nodes + node);
+                        const size_t position = node * elements_per_node + i;
+                        all_equal &= buffer[position] == value;
+                        all_equal &= buffer[step_size + position] == -value;
+                    }
+                }
+                REQUIRE(all_equal);
+            }
+            sonata->check_and_write(1);
+            sonata->close();
+            H5Fclose(file_handler);
+        }
+    }
+    GIVEN("Nodes recorded by several simulator threads") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        const int num_nodes = 1000;
+        const int num_threads = 4;
+        std::vector<double> voltages(num_nodes);
+        std::iota(voltages.begin(), voltages.end(), 0.0);
+        auto nodes = std::make_shared<NodeTable>();
+        // Thread t owns the nodes t, t + num_threads, ...
+        std::vector<std::vector<int>> thread_nodes(num_threads);
+        for (int node = 0; node < num_nodes; ++node) {
+            const uint64_t node_id = population_offset + 1 + node;
+            nodes->add_node(node_id);
+            nodes->add_element(node_id, &voltages[node], 0);
+            thread_nodes[node % num_threads].push_back(node_id);
+        }
+        WHEN("Every thread records its own nodes for two steps") {
+            std::string report_name = "test_sonatadata_concurrent";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1024 * 1024,
+                                                       2,
+                                                       dt,
+                                                       0.0,
+                                                       2.0,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            for (int step = 0; step < 2; ++step) {
+                std::vector<std::thread> threads;
+                for (const auto& ids : thread_nodes) {
+                    threads.emplace_back([&sonata, &ids, step] {
+                        // Several calls per thread and step, as simulators do per cell group
+                        const size_t half = ids.size() / 2;
+                        sonata->record_data(step, ids.data(), half);
+                        sonata->record_data(step, ids.data() + half, ids.size() - half);
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+                std::transform(voltages.begin(),
+                               voltages.end(),
+                               voltages.begin(),
+                               [](double v) { return v + 0.5; });
+            }
+
+            THEN("Every node is recorded once per step at its place in the buffer") {
+                const report_buffer_t& buffer = sonata->get_report_buffer();
+                REQUIRE(buffer.size() == 2 * num_nodes);
+                bool all_equal = true;
+                for (int node = 0; node < num_nodes; ++node) {
+                    all_equal &= buffer[node] == node;
+                    all_equal &= buffer[num_nodes + node] == node + 0.5f;
+                }
+                REQUIRE(all_equal);
+            }
+            sonata->check_and_write(1);
+            sonata->close();
+            H5Fclose(file_handler);
+        }
+    }
+    GIVEN("Buffers written by the writer thread") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        std::vector<double> voltages{1.0, 2.0, 3.0};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        WHEN("We record more steps than a buffer holds with 2 buffers") {
+            const int num_steps = 5;
+            std::string report_name = "test_sonatadata_async";
+            sonata_set_min_steps_to_record(1);
+            sonata_set_num_write_buffers(2);
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            // Room for a single step per buffer
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       voltages.size() * sizeof(float),
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            sonata_set_num_write_buffers(1);
+            std::vector<const void*> buffers;
+            for (int step = 0; step < num_steps; ++step) {
+                buffers.push_back(sonata->get_report_data());
+                sonata->record_data(step);
+                sonata->check_and_write(step);
+                for (double& voltage : voltages) {
+                    voltage += 10.0;
+                }
+            }
+            sonata->close();
+            H5Fclose(file_handler);
+
+            THEN("Each step is recorded into a buffer other than the one being written") {
+                for (int step = 1; step < num_steps; ++step) {
+                    REQUIRE(buffers[step] != buffers[step - 1]);
+                }
+                std::sort(buffers.begin(), buffers.end());
+                REQUIRE(std::unique(buffers.begin(), buffers.end()) - buffers.begin() == 2);
+            }
+            THEN("Every step is written in order") {
+                hid_t file = H5Fopen("test_sonatadata_async.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+                hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+                std::vector<float> data(num_steps * voltages.size());
+                H5Dread(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                H5Dclose(dataset);
+                H5Fclose(file);
+                std::vector<float> compare;
+                for (int step = 0; step < num_steps; ++step) {
+                    for (float voltage : {1.f, 2.f, 3.f}) {
+                        compare.push_back(voltage + 10.f * step);
+                    }
+                }
+                REQUIRE(data == compare);
+            }
+        }
+    }
+    GIVEN("A flush started before the next steps are recorded") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        std::vector<double> voltages{1.0, 2.0};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        WHEN("We record a step into the single buffer while the previous ones are written") {
+            const int num_steps = 3;
+            std::string report_name = "test_sonatadata_split_flush";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1024,
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            for (int step = 0; step < num_steps; ++step) {
+                if (step == num_steps - 1) {
+                    sonata->write_data(true);
+                }
+                sonata->record_data(step);
+                for (double& voltage : voltages) {
+                    voltage += 10.0;
+                }
+            }
+            sonata->wait_for_writes();
+            sonata->write_data();
+            sonata->close();
+            H5Fclose(file_handler);
+
+            THEN("The steps written in the background are not overwritten") {
+                hid_t file = H5Fopen("test_sonatadata_split_flush.h5",
+                                     H5F_ACC_RDONLY,
+                                     H5P_DEFAULT);
+                hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+                std::vector<float> data(num_steps * voltages.size());
+                H5Dread(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                H5Dclose(dataset);
+                H5Fclose(file);
+                REQUIRE(data == std::vector<float>{1.f, 2.f, 11.f, 12.f, 21.f, 22.f});
+            }
+        }
+        WHEN("We fill the single buffer while the previous steps are written") {
+            const int num_steps = 5;
+            std::string report_name = "test_sonatadata_split_flush_full";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            // Room for 2 steps, written synchronously once full
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       2 * voltages.size() * sizeof(float),
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->prepare_dataset();
+            for (int step = 0; step < num_steps; ++step) {
+                if (step == 1) {
+                    sonata->write_data(true);
+                }
+                sonata->record_data(step);
+                for (double& voltage : voltages) {
+                    voltage += 10.0;
+                }
+            }
+            sonata->wait_for_writes();
+            sonata->write_data();
+            sonata->close();
+            H5Fclose(file_handler);
+
+            THEN("Every step is written at its row") {
+                hid_t file = H5Fopen("test_sonatadata_split_flush_full.h5",
+                                     H5F_ACC_RDONLY,
+                                     H5P_DEFAULT);
+                hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+                std::vector<float> data(num_steps * voltages.size());
+                H5Dread(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                H5Dclose(dataset);
+                H5Fclose(file);
+                std::vector<float> compare;
+                for (int step = 0; step < num_steps; ++step) {
+                    compare.push_back(1.f + 10.f * step);
+                    compare.push_back(2.f + 10.f * step);
+                }
+                REQUIRE(data == compare);
+            }
+        }
+    }
+    GIVEN("A compressed population") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        sonata_set_min_steps_to_record(1);
+        const int num_steps = 5;
+        std::vector<double> voltages{1.0, 2.0, 3.0};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        std::vector<float> compare;
+        for (int step = 0; step < num_steps; ++step) {
+            for (float voltage : {1.f, 2.f, 3.f}) {
+                compare.push_back(voltage + 10.f * step);
+            }
+        }
+        // Write the population and open its data, room for two steps per buffer
+        auto write_population = [&](const std::string& report_name,
+                                     const Compression& compression) {
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       2 * voltages.size() * sizeof(float),
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_compression(compression);
+            sonata->prepare_dataset();
+            for (int step = 0; step < num_steps; ++step) {
+                sonata->record_data(step);
+                sonata->check_and_write(step);
+                for (double& voltage : voltages) {
+                    voltage += 10.0;
+                }
+            }
+            sonata->write_data();
+            sonata->close();
+            H5Fclose(file_handler);
+            return H5Fopen((report_name + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        };
+        auto read_data = [&](hid_t dataset) {
+            std::vector<float> data(num_steps * voltages.size());
+            H5Dread(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+            return data;
+        };
+        auto get_chunk = [](hid_t dataset) {
+            hid_t create_list = H5Dget_create_plist(dataset);
+            std::array<hsize_t, 2> chunk = {0, 0};
+            if (H5Pget_layout(create_list) == H5D_CHUNKED && H5Pget_nfilters(create_list) == 2) {
+                H5Pget_chunk(create_list, 2, chunk.data());
+            }
+            H5Pclose(create_list);
+            return chunk;
+        };
+        WHEN("We write it with the default chunks") {
+            Compression compression;
+            compression.level = 4;
+            hid_t file = write_population("test_sonatadata_compressed", compression);
+            hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+            THEN("The data is shuffled and deflated in chunks of a buffer") {
+                REQUIRE(get_chunk(dataset) == std::array<hsize_t, 2>{2, 3});
+            }
+            THEN("Every step reads back") {
+                REQUIRE(read_data(dataset) == compare);
+            }
+            H5Dclose(dataset);
+            H5Fclose(file);
+        }
+        WHEN("We compress the chunks on 2 threads and write them directly") {
+            // Chunks past the last step and element, padded when written directly
+            Compression compression;
+            compression.level = 4;
+            compression.chunk_elements = 2;
+            compression.direct_chunk_write = true;
+            sonata_set_num_compression_threads(2);
+            hid_t file = write_population("test_sonatadata_direct", compression);
+            sonata_set_num_compression_threads(1);
+            hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+            THEN("The data is in chunks for the HDF5 filters") {
+                REQUIRE(get_chunk(dataset) == std::array<hsize_t, 2>{2, 2});
+            }
+            THEN("Every step reads back through them") {
+                REQUIRE(read_data(dataset) == compare);
+            }
+            H5Dclose(dataset);
+            H5Fclose(file);
+        }
+    }
+    GIVEN("A quantized population") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        sonata_set_min_steps_to_record(1);
+        const int num_steps = 2;
+        // From the fifth one, values out of the range of the integers and NaN, both in the blocks
+        // of 4 values quantized together and in the last 2
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        std::vector<double> voltages{
+            -65.123, -70.456, 12.3456, -65.0, 1e4, -1e4, nan, -65.0, -1e4, nan};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        auto create_population = [&](const std::string& report_name,
+                                     hid_t file_handler,
+                                     const Storage& storage,
+                                     const Compression& compression) {
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1048576,
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_storage(storage);
+            sonata->set_compression(compression);
+            sonata->prepare_dataset();
+            return sonata;
+        };
+        auto read_attribute = [](hid_t dataset, const char* name) {
+            double value = 0;
+            hid_t attribute = H5Aopen(dataset, name, H5P_DEFAULT);
+            H5Aread(attribute, H5T_NATIVE_DOUBLE, &value);
+            H5Aclose(attribute);
+            return value;
+        };
+        WHEN("We record it as 16 bit integers within 0.01") {
+            Storage storage;
+            storage.type = StorageType::int16;
+            storage.scale = 0.02;
+            storage.offset = -65.0;
+            const std::string report_name = "test_sonatadata_int16";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = create_population(report_name, file_handler, storage, {});
+            sonata->record_data(0);
+            const report_buffer_t decoded = sonata->get_report_buffer();
+            sonata->record_data(1);
+            sonata->close();
+            H5Fclose(file_handler);
+
+            THEN("The recorded values are decoded within the error") {
+                REQUIRE(decoded.size() == num_steps * voltages.size());
+                for (size_t i = 0; i < 4; ++i) {
+                    REQUIRE(std::abs(decoded[i] - voltages[i]) <= 0.01 + 1e-5);
+                }
+                REQUIRE(decoded[3] == -65.f);
+                REQUIRE(decoded[7] == -65.f);
+            }
+            THEN("The values out of range are clamped to the same distance on both sides") {
+                REQUIRE(decoded[4] == Approx(-65.0 + 32767 * 0.02));
+                REQUIRE(decoded[5] == Approx(-65.0 - 32767 * 0.02));
+                REQUIRE(decoded[8] == Approx(-65.0 - 32767 * 0.02));
+            }
+            THEN("The file holds the integers with the attributes decoding them") {
+                hid_t file = H5Fopen((report_name + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+                hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+                hid_t type = H5Dget_type(dataset);
+                REQUIRE(H5Tequal(type, H5T_STD_I16LE) > 0);
+                H5Tclose(type);
+                const double scale = read_attribute(dataset, "scale_factor");
+                const double offset = read_attribute(dataset, "add_offset");
+                REQUIRE(scale == 0.02);
+                REQUIRE(offset == -65.0);
+                hid_t fill_attribute = H5Aopen(dataset, "_FillValue", H5P_DEFAULT);
+                hid_t fill_type = H5Aget_type(fill_attribute);
+                REQUIRE(H5Tequal(fill_type, H5T_STD_I16LE) > 0);
+                int16_t fill_value = 0;
+                H5Aread(fill_attribute, H5T_NATIVE_SHORT, &fill_value);
+                REQUIRE(fill_value == -32768);
+                H5Tclose(fill_type);
+                H5Aclose(fill_attribute);
+                std::vector<int16_t> data(num_steps * voltages.size());
+                H5Dread(dataset, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                H5Dclose(dataset);
+                H5Fclose(file);
+                for (size_t i = 0; i < data.size(); ++i) {
+                    REQUIRE(data[i] * scale + offset == Approx(decoded[i % voltages.size()]));
+                }
+                // Only NaN is read as missing
+                for (size_t i = 0; i < voltages.size(); ++i) {
+                    REQUIRE((data[i] == fill_value) == std::isnan(voltages[i]));
+                }
+            }
+        }
+        WHEN("We record it as 8 bit integers compressed in chunks written directly") {
+            Storage storage;
+            storage.type = StorageType::int8;
+            storage.scale = 1.0;
+            storage.offset = -65.0;
+            Compression compression;
+            compression.level = 4;
+            compression.chunk_elements = 2;
+            compression.direct_chunk_write = true;
+            const std::string report_name = "test_sonatadata_int8";
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = create_population(report_name, file_handler, storage, compression);
+            sonata->record_data(0);
+            sonata->record_data(1);
+            sonata->close();
+            H5Fclose(file_handler);
+
+            THEN("Every value reads back rounded to the scale, only NaN being the fill value") {
+                hid_t file = H5Fopen((report_name + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+                hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+                std::vector<int8_t> data(num_steps * voltages.size());
+                H5Dread(dataset, H5T_NATIVE_SCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                int8_t fill_value = 0;
+                hid_t fill_attribute = H5Aopen(dataset, "_FillValue", H5P_DEFAULT);
+                H5Aread(fill_attribute, H5T_NATIVE_SCHAR, &fill_value);
+                H5Aclose(fill_attribute);
+                H5Dclose(dataset);
+                H5Fclose(file);
+                const std::vector<int8_t> step{0, -5, 77, 0, 127, -127, -128, 0, -127, -128};
+                for (size_t i = 0; i < data.size(); ++i) {
+                    REQUIRE(data[i] == step[i % step.size()]);
+                }
+                REQUIRE(fill_value == -128);
+            }
+        }
+    }
+    GIVEN("A population stored as doubles or halves") {
+        double dt = 1.0;
+        sonata_set_atomic_step(dt);
+        sonata_set_min_steps_to_record(1);
+        const int num_steps = 2;
+        std::vector<double> currents{1e-12, -3.25, 0.1, 1e6};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < currents.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &currents[node], 0);
+        }
+        // Write two steps of the population and read them back as doubles
+        auto write_population = [&](const std::string& report_name,
+                                     StorageType type,
+                                     const Compression& compression) {
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1048576,
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            Storage storage;
+            storage.type = type;
+            sonata->set_storage(storage);
+            sonata->set_compression(compression);
+            sonata->prepare_dataset();
+            sonata->record_data(0);
+            sonata->record_data(1);
+            sonata->close();
+            H5Fclose(file_handler);
+
+            hid_t file = H5Fopen((report_name + ".h5").c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+            hid_t dataset = H5Dopen(file, "/report/All/data", H5P_DEFAULT);
+            hid_t file_type = H5Dget_type(dataset);
+            const size_t value_size = H5Tget_size(file_type);
+            H5Tclose(file_type);
+            std::vector<double> data(num_steps * currents.size());
+            H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+            H5Dclose(dataset);
+            H5Fclose(file);
+            return std::make_pair(value_size, data);
+        };
+        WHEN("We store it as doubles") {
+            const auto result = write_population("test_sonatadata_float64",
+                                                 StorageType::float64,
+                                                 {});
+            THEN("Every value is written without rounding") {
+                REQUIRE(result.first == 8);
+                REQUIRE(result.second == std::vector<double>{1e-12, -3.25, 0.1, 1e6,
+                                                             1e-12, -3.25, 0.1, 1e6});
+            }
+        }
+        WHEN("We store it as halves compressed in chunks written directly") {
+            Compression compression;
+            compression.level = 4;
+            compression.chunk_elements = 3;
+            compression.direct_chunk_write = true;
+            const auto result = write_population("test_sonatadata_float16",
+                                                 StorageType::float16,
+                                                 compression);
+            THEN("Every value is rounded to a half") {
+                REQUIRE(result.first == 2);
+                const double infinity = std::numeric_limits<double>::infinity();
+                const double tenth = 0.0999755859375;
+                REQUIRE(result.second ==
+                        std::vector<double>{0, -3.25, tenth, infinity, 0, -3.25, tenth, infinity});
+            }
+        }
+    }
+    GIVEN("A population sampled over each reporting period") {
+        // Reporting every 4 steps, the value of the first element being the step and the second
+        // its opposite
+        sonata_set_atomic_step(1.0);
+        const double dt = 4.0;
+        const int num_steps = 2;
+        std::vector<double> voltages{0.0, 0.0};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        // Drive the population as a report does over the steps of the simulation
+        auto record = [&](const std::string& report_name, Sampling sampling, bool by_node) {
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1048576,
+                                                       num_steps,
+                                                       dt,
+                                                       0.0,
+                                                       num_steps * dt,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_sampling(sampling);
+            sonata->prepare_dataset();
+            const std::vector<uint64_t> node_ids = {population_offset + 1, population_offset + 2};
+            for (int step = 0; step < num_steps * dt; ++step) {
+                voltages = {static_cast<double>(step), -static_cast<double>(step)};
+                if (sonata->is_due_to_report(step)) {
+                    if (by_node) {
+                        sonata->record_data(step, node_ids);
+                        sonata->check_and_write(step);
+                    } else {
+                        sonata->record_data(step);
+                    }
+                } else if (sonata->is_in_window(step)) {
+                    if (by_node) {
+                        sonata->accumulate(node_ids);
+                    } else {
+                        sonata->accumulate(step);
+                    }
+                }
+            }
+            const report_buffer_t buffer = sonata->get_report_buffer();
+            sonata->close();
+            H5Fclose(file_handler);
+            return buffer;
+        };
+        WHEN("We record the instantaneous values") {
+            THEN("The steps in between are ignored") {
+                REQUIRE(record("test_sonatadata_sampled", Sampling::instantaneous, false) ==
+                        report_buffer_t{0, 0, 4, -4});
+            }
+        }
+        WHEN("We record the mean of each period") {
+            THEN("The values of its steps are averaged") {
+                REQUIRE(record("test_sonatadata_mean", Sampling::mean, false) ==
+                        report_buffer_t{0, 0, 2.5, -2.5});
+            }
+            THEN("The data is marked as sampled by its mean") {
+                hid_t file = H5Fopen("test_sonatadata_mean.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+                REQUIRE(H5Aexists_by_name(file, "/report/All/data", "sampling", H5P_DEFAULT) > 0);
+                H5Fclose(file);
+            }
+        }
+        WHEN("We record the mean of each period node by node") {
+            THEN("The values of its steps are averaged") {
+                REQUIRE(record("test_sonatadata_mean_nodes", Sampling::mean, true) ==
+                        report_buffer_t{0, 0, 2.5, -2.5});
+            }
+        }
+        WHEN("We record the min and the max of each period") {
+            THEN("They are taken over its steps") {
+                REQUIRE(record("test_sonatadata_min", Sampling::min, false) ==
+                        report_buffer_t{0, 0, 1, -4});
+                REQUIRE(record("test_sonatadata_max", Sampling::max, true) ==
+                        report_buffer_t{0, 0, 4, -1});
+            }
+        }
+    }
+    GIVEN("A population summed by element id and by node") {
+        sonata_set_atomic_step(1.0);
+        std::vector<double> voltages{1.0, 2.0, 3.0, 4.0, 5.0};
+        auto nodes = std::make_shared<NodeTable>(NodeTable::unlimited,
+                                                 std::make_shared<Arena>(),
+                                                 true);
+        nodes->add_node(population_offset + 1);
+        nodes->add_node(population_offset + 2);
+        nodes->add_element(population_offset + 1, &voltages[0], 1);
+        nodes->add_weighted_element(population_offset + 1, &voltages[1], 0, 0.5);
+        nodes->add_weighted_element(population_offset + 1, &voltages[2], 1, 2.0);
+        nodes->add_element(population_offset + 2, &voltages[3], 0);
+        nodes->add_element(population_offset + 2, &voltages[4], 0);
+        auto record = [&](const std::string& report_name, Summation summation, bool by_node) {
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1048576,
+                                                       1,
+                                                       1.0,
+                                                       0.0,
+                                                       1.0,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_summation(summation);
+            sonata->prepare_dataset();
+            if (by_node) {
+                sonata->record_data(0, {population_offset + 2, population_offset + 1});
+            } else {
+                sonata->record_data(0);
+            }
+            const report_buffer_t buffer = sonata->get_report_buffer();
+            const auto element_ids = sonata->get_element_ids();
+            sonata->close();
+            H5Fclose(file_handler);
+            return std::make_pair(buffer, element_ids);
+        };
+        WHEN("We sum the elements with the same id") {
+            const auto summed =
+                record("test_sonatadata_sum_elements", Summation::by_element, false);
+            THEN("Each node gets a weighted sum per element id") {
+                REQUIRE(summed.first == report_buffer_t{1, 7, 9});
+                REQUIRE(summed.second == std::vector<uint32_t>{0, 1, 0});
+            }
+        }
+        WHEN("We sum every element of each node, node by node") {
+            const auto summed = record("test_sonatadata_sum_nodes", Summation::by_node, true);
+            THEN("Each node gets a single weighted sum") {
+                REQUIRE(summed.first == report_buffer_t{8, 9});
+                REQUIRE(summed.second == std::vector<uint32_t>{0, 0});
+            }
+        }
+    }
+    GIVEN("A population with statistics over the whole report") {
+        // The first element is the step and the second its square
+        sonata_set_atomic_step(1.0);
+        const int num_steps = 4;
+        std::vector<double> voltages{0.0, 0.0};
+        auto nodes = std::make_shared<NodeTable>();
+        for (uint64_t node = 0; node < voltages.size(); ++node) {
+            nodes->add_node(population_offset + 1 + node);
+            nodes->add_element(population_offset + 1 + node, &voltages[node], 0);
+        }
+        auto record = [&](const std::string& report_name, Statistics statistics) {
+            hid_t file_handler = Implementation::prepare_write(report_name);
+            auto sonata = std::make_unique<SonataData>(report_name,
+                                                       population_name,
+                                                       population_offset,
+                                                       1048576,
+                                                       num_steps,
+                                                       1.0,
+                                                       0.0,
+                                                       num_steps,
+                                                       report_units,
+                                                       nodes,
+                                                       file_handler);
+            sonata->set_statistics(statistics);
+            sonata->prepare_dataset();
+            for (int step = 0; step < num_steps; ++step) {
+                voltages = {static_cast<double>(step), static_cast<double>(step * step)};
+                sonata->record_data(step);
+            }
+            const RunningStatistics running_statistics = sonata->get_statistics();
+            const report_buffer_t buffer = sonata->get_report_buffer();
+            sonata->close();
+            H5Fclose(file_handler);
+            return std::make_pair(running_statistics, buffer);
+        };
+        auto read_statistics = [](const std::string& file_name, const std::string& name) {
+            hid_t file = H5Fopen(file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+            hid_t dataset = H5Dopen(file, ("/report/All/statistics/" + name).c_str(), H5P_DEFAULT);
+            std::vector<double> values(2);
+            H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.data());
+            H5Dclose(dataset);
+            H5Fclose(file);
+            return values;
+        };
+        WHEN("We record the statistics along with the data") {
+            const auto recorded = record("test_sonatadata_statistics", Statistics::with_data);
+            THEN("They are taken over every step") {
+                const RunningStatistics& statistics = recorded.first;
+                REQUIRE(statistics.get_counts() == std::vector<uint32_t>{4, 4});
+                REQUIRE(statistics.get_min() == std::vector<double>{0, 0});
+                REQUIRE(statistics.get_max() == std::vector<double>{3, 9});
+                REQUIRE(statistics.get_mean() == std::vector<double>{1.5, 3.5});
+                REQUIRE(statistics.get_variance()[0] == Approx(1.25));
+                REQUIRE(statistics.get_variance()[1] == Approx(12.25));
+            }
+            THEN("The data is still recorded") {
+                REQUIRE(recorded.second == report_buffer_t{0, 0, 1, 1, 2, 4, 3, 9});
+            }
+            THEN("They are written in the statistics group") {
+                REQUIRE(read_statistics("test_sonatadata_statistics.h5", "mean") ==
+                        std::vector<double>{1.5, 3.5});
+                REQUIRE(read_statistics("test_sonatadata_statistics.h5", "variance")[1] ==
+                        Approx(12.25));
+            }
+        }
+        WHEN("We record the statistics without the data") {
+            const auto recorded = record("test_sonatadata_statistics_only",
+                                         Statistics::without_data);
+            THEN("Only the statistics are written") {
+                REQUIRE(recorded.second.empty());
+                REQUIRE(read_statistics("test_sonatadata_statistics_only.h5", "max") ==
+                        std::vector<double>{3, 9});
+                hid_t file =
+                    H5Fopen("test_sonatadata_statistics_only.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+                REQUIRE(H5Lexists(file, "/report/All/data", H5P_DEFAULT) == 0);
+                REQUIRE(H5Lexists(file, "/report/All/mapping/element_ids", H5P_DEFAULT) > 0);
+                H5Fclose(file);
+            }
+        }
+    }
     GIVEN("Spike data") {
         std::vector<double> spike_timestamps{0.3, 0.1, 0.2, 1.3, 0.7};
         std::vector<uint64_t> spike_node_ids{3, 5, 2, 3, 2};
@@ -1,6 +1,9 @@
 #include <array>
 #include <bbp/sonata/reports.h>
 #include <catch2/catch.hpp>
+#include <hdf5.h>
+#include <string>
+#include <vector>
 
 static const char* element_report_name = "myElementReport";
 static const char* soma_report_name = "mySomaReport";
@@ -84,6 +87,15 @@ SCENARIO("Test SonataReport API", "[sonatareport]") {
             REQUIRE(sonata_add_element(
                         weird_report_name, population_name, 1, element_id, &soma_value) == -2);
             REQUIRE(sonata_set_report_max_buffer_size_hint(weird_report_name, 1) == -1);
+            REQUIRE(sonata_set_report_compression(weird_report_name, 4, 0, 0) == -1);
+            REQUIRE(sonata_set_report_quantization(weird_report_name, 16, 0.01, -65.0) == -1);
+            REQUIRE(sonata_set_report_precision(weird_report_name, 64) == -1);
+            REQUIRE(sonata_set_report_sampling(weird_report_name, "mean") == -1);
+            REQUIRE(sonata_set_report_summation(weird_report_name, "node") == -1);
+            REQUIRE(sonata_set_report_statistics(weird_report_name, "with_data") == -1);
+            REQUIRE(sonata_add_weighted_element(
+                        weird_report_name, population_name, 1, element_id, &soma_value, 0.5) ==
+                    -2);
             REQUIRE(sonata_record_node_data(1.0, 1, nodeids, weird_report_name) == -1);
         }
     }
@@ -102,9 +114,34 @@ SCENARIO("Test SonataReport API", "[sonatareport]") {
             }
         }
         sonata_set_report_max_buffer_size_hint(report_name, 1);
+        sonata_set_report_compression(report_name, 4, 0, 0);
         THEN("Number of reports is 3") {
             REQUIRE(sonata_get_num_reports() == 3);
         }
+        THEN("A compression level above 9 is rejected") {
+            REQUIRE(sonata_set_report_compression(report_name, 10, 0, 0) == -2);
+        }
+        THEN("Only 16 and 8 bit quantization within a positive error is accepted") {
+            REQUIRE(sonata_set_report_quantization(report_name, 12, 0.01, -65.0) == -2);
+            REQUIRE(sonata_set_report_quantization(report_name, 16, 0.0, -65.0) == -2);
+            REQUIRE(sonata_set_report_quantization(report_name, 0, 0.0, 0.0) == 0);
+        }
+        THEN("An unknown sampling is rejected") {
+            REQUIRE(sonata_set_report_sampling(report_name, "median") == -2);
+            REQUIRE(sonata_set_report_sampling(report_name, "instantaneous") == 0);
+        }
+        THEN("An unknown statistics mode is rejected") {
+            REQUIRE(sonata_set_report_statistics(report_name, "median") == -2);
+            REQUIRE(sonata_set_report_statistics(report_name, "none") == 0);
+        }
+        THEN("Only summation reports sum their elements") {
+            REQUIRE(sonata_set_report_summation(report_name, "node") == -2);
+        }
+        THEN("Only 64, 32 and 16 bit floats are accepted") {
+            REQUIRE(sonata_set_report_precision(report_name, 8) == -2);
+            REQUIRE(sonata_set_report_precision(report_name, 64) == 0);
+            REQUIRE(sonata_set_report_precision(report_name, 32) == 0);
+        }
     }
 
     WHEN("We record data") {
@@ -138,6 +175,184 @@ SCENARIO("Test SonataReport API", "[sonatareport]") {
         }
     }
 
+    WHEN("We add elements as positions of an array") {
+        const char* report_name = "indexedReport";
+        std::array<double, 4> values{1.5, 2.5, 3.5, 4.5};
+        std::array<double, 4> moved_values{};
+        const uint32_t indices[2] = {3, 1};
+        const uint32_t element_ids[2] = {0, 1};
+        sonata_create_report(report_name, tstart, tend, dt, report_units, "compartment");
+        sonata_add_node(report_name, population_name, population_offset, 1);
+        THEN("The elements are added and the array can be moved") {
+            REQUIRE(sonata_add_elements_indexed(
+                        report_name, population_name, 1, values.data(), indices, element_ids, 2) ==
+                    0);
+            REQUIRE(sonata_add_elements_indexed(
+                        report_name, population_name, 2, values.data(), indices, element_ids, 2) ==
+                    -3);
+            REQUIRE(sonata_add_elements_indexed(
+                        "noReport", population_name, 1, values.data(), indices, element_ids, 2) ==
+                    -2);
+            REQUIRE(sonata_rebase_array(values.data(), moved_values.data()) == 0);
+            REQUIRE(sonata_rebase_array(values.data(), moved_values.data()) == -1);
+        }
+        sonata_clear();
+    }
+
+    WHEN("We add nodes and elements in bulk") {
+        const char* report_name = "bulkReport";
+        const uint64_t node_ids[3] = {1, 2, 3};
+        const uint64_t offsets[4] = {0, 2, 3, 5};
+        const uint32_t element_ids[5] = {0, 1, 0, 0, 1};
+        std::array<double, 5> values{1, 2, 3, 4, 5};
+        double* element_values[5] = {&values[0], &values[1], &values[2], &values[3], &values[4]};
+        sonata_create_report(report_name, tstart, tend, dt, report_units, "compartment");
+        THEN("The nodes and elements are added and the errors are reported") {
+            REQUIRE(sonata_add_nodes(
+                        report_name, population_name, population_offset, node_ids, 3) == 0);
+            REQUIRE(sonata_add_nodes(
+                        report_name, population_name, population_offset, node_ids, 1) == -1);
+            REQUIRE(sonata_add_nodes(
+                        "noReport", population_name, population_offset, node_ids, 3) == -2);
+            REQUIRE(sonata_add_elements_bulk(report_name,
+                                             population_name,
+                                             node_ids,
+                                             3,
+                                             offsets,
+                                             element_ids,
+                                             element_values) == 0);
+            REQUIRE(sonata_add_elements_bulk("noReport",
+                                             population_name,
+                                             node_ids,
+                                             3,
+                                             offsets,
+                                             element_ids,
+                                             element_values) == -2);
+            REQUIRE(sonata_add_elements_bulk(report_name,
+                                             "noPopulation",
+                                             node_ids,
+                                             3,
+                                             offsets,
+                                             element_ids,
+                                             element_values) == -3);
+        }
+        sonata_clear();
+    }
+
+    WHEN("We use handles to a report and a population") {
+        const char* report_name = "handleReport";
+        std::array<double, 3> values{1.5, 2.5, 3.5};
+        const int node_ids[2] = {2, 1};
+        sonata_create_report(report_name, tstart, tend, dt, report_units, "compartment");
+        sonata_report_handle_t report = sonata_get_report_handle(report_name);
+        THEN("Nodes, elements and records go through the handles") {
+            REQUIRE(report != nullptr);
+            REQUIRE(sonata_get_report_handle("noReport") == nullptr);
+            REQUIRE(sonata_get_population_handle(report, population_name) == nullptr);
+            REQUIRE(sonata_report_add_node(report, population_name, population_offset, 1) == 0);
+            REQUIRE(sonata_report_add_node(report, population_name, population_offset, 2) == 0);
+            REQUIRE(sonata_report_add_node(nullptr, population_name, population_offset, 3) == -2);
+
+            sonata_population_handle_t population = sonata_get_population_handle(report,
+                                                                                 population_name);
+            REQUIRE(population != nullptr);
+            REQUIRE(sonata_get_population_handle(nullptr, population_name) == nullptr);
+            REQUIRE(sonata_population_add_element(population, 1, 0, &values[0]) == 0);
+            REQUIRE(sonata_population_add_element(population, 2, 0, &values[1]) == 0);
+            REQUIRE(sonata_population_add_element(population, 2, 1, &values[2]) == 0);
+            REQUIRE(sonata_population_add_element(population, 3, 0, &values[2]) == -3);
+            REQUIRE(sonata_population_add_element(nullptr, 1, 0, &values[2]) == -2);
+            REQUIRE(sonata_add_element(report_name, "noPopulation", 1, 0, &values[2]) == -3);
+
+            sonata_set_atomic_step(dt);
+            sonata_setup_communicators();
+            sonata_prepare_datasets();
+            REQUIRE(sonata_report_record_node_data(report, 0.0, node_ids, 2) == 0);
+            REQUIRE(sonata_report_record_node_data(report, 1.0, node_ids, 0) == 0);
+            REQUIRE(sonata_report_record_node_data(nullptr, 1.0, node_ids, 2) == -1);
+            REQUIRE(sonata_record_node_data(1.0, 2, node_ids, report_name) == 0);
+            sonata_flush(tend);
+        }
+        sonata_clear();
+    }
+
+    WHEN("We flush in two phases") {
+        const char* report_name = "splitFlushReport";
+        std::array<double, 2> values{1.5, 2.5};
+        REQUIRE(sonata_flush_begin(tend) == -3);
+        REQUIRE(sonata_flush_end(tend) == -3);
+        sonata_create_report(report_name, tstart, tend, dt, report_units, "compartment");
+        sonata_add_node(report_name, population_name, population_offset, 1);
+        sonata_add_element(report_name, population_name, 1, 0, &values[0]);
+        sonata_add_element(report_name, population_name, 1, 1, &values[1]);
+        sonata_set_atomic_step(dt);
+        sonata_setup_communicators();
+        sonata_prepare_datasets();
+        THEN("The flush can be started and completed separately") {
+            for (int step = 0; step < 3; ++step) {
+                REQUIRE(sonata_record_data(step) == 0);
+            }
+            REQUIRE(sonata_flush_begin(tend) == 0);
+            values[0] = 0.;
+            REQUIRE(sonata_flush_end(tend) == 0);
+        }
+        sonata_clear();
+    }
+
+    WHEN("We flush two populations whose buffers are written by the writer thread") {
+        const char* report_name = "asyncPopulationsReport";
+        const std::array<const char*, 2> population_names{"NodeA", "NodeB"};
+        const int num_steps = 24;
+        const uint32_t num_elements = 20000;
+        // 13 steps per buffer, the last buffer being still queued when flushing
+        std::vector<double> values(2 * num_elements);
+        sonata_create_report(report_name, 0.0, num_steps * 1.0, 1.0, report_units, "compartment");
+        for (size_t population = 0; population < population_names.size(); ++population) {
+            sonata_add_node(report_name, population_names[population], population_offset, 1);
+            for (uint32_t element = 0; element < num_elements; ++element) {
+                sonata_add_element(report_name,
+                                   population_names[population],
+                                   1,
+                                   element,
+                                   &values[population * num_elements + element]);
+            }
+        }
+        sonata_set_report_max_buffer_size_hint(report_name, 1);
+        sonata_set_report_compression(report_name, 9, 0, 0);
+        sonata_set_report_statistics(report_name, "with_data");
+        sonata_set_atomic_step(1.0);
+        sonata_set_num_write_buffers(2);
+        sonata_setup_communicators();
+        sonata_prepare_datasets();
+        sonata_set_num_write_buffers(1);
+        for (int step = 0; step < num_steps; ++step) {
+            for (size_t i = 0; i < values.size(); ++i) {
+                values[i] = step + (i < num_elements ? 0.0 : 0.5);
+            }
+            sonata_record_data(step);
+            sonata_check_and_flush(step);
+        }
+        REQUIRE(sonata_flush(num_steps) == 0);
+        sonata_clear();
+        THEN("Every step of both populations is written") {
+            hid_t file = H5Fopen("asyncPopulationsReport.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+            for (size_t population = 0; population < population_names.size(); ++population) {
+                const std::string group = std::string("/report/") + population_names[population];
+                hid_t dataset = H5Dopen(file, (group + "/data").c_str(), H5P_DEFAULT);
+                std::vector<float> data(num_steps * num_elements);
+                H5Dread(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data());
+                H5Dclose(dataset);
+                bool all_steps = true;
+                for (size_t i = 0; i < data.size(); ++i) {
+                    all_steps &= data[i] == i / num_elements + 0.5f * population;
+                }
+                REQUIRE(all_steps);
+                REQUIRE(H5Lexists(file, (group + "/statistics/mean").c_str(), H5P_DEFAULT) > 0);
+            }
+            H5Fclose(file);
+        }
+    }
+
     WHEN("We call not implemented functions") {
         const int values[2] = {0, 1};
         std::string name = "report";
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <numeric>
+#include <random>
+#include <utils/spike_sort.h>
+#include <vector>
+
+using namespace bbp::sonata;
+
+// Spikes sorted as the two stable sorts of a permutation used to do
+std::pair<std::vector<double>, std::vector<uint64_t>> reference_sort(
+    const std::vector<double>& times, const std::vector<uint64_t>& node_ids, bool by_id) {
+    std::vector<size_t> order(times.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return by_id ? times[lhs] < times[rhs] : node_ids[lhs] < node_ids[rhs];
+    });
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return by_id ? node_ids[lhs] < node_ids[rhs] : times[lhs] < times[rhs];
+    });
+    std::pair<std::vector<double>, std::vector<uint64_t>> sorted;
+    for (size_t i : order) {
+        sorted.first.push_back(times[i]);
+        sorted.second.push_back(node_ids[i]);
+    }
+    return sorted;
+}
+
+SCENARIO("Test spike sorting", "[SpikeSort]") {
+    GIVEN("Times of any sign") {
+        THEN("Their bits are ordered as they are and converted back") {
+            const std::vector<double> times{-1e300, -2.5, -0.0, 0.0, 1e-310, 0.1, 3.0, 1e300};
+            for (size_t i = 0; i + 1 < times.size(); ++i) {
+                REQUIRE(to_time_bits(times[i]) <= to_time_bits(times[i + 1]));
+                REQUIRE(from_time_bits(to_time_bits(times[i + 1])) == times[i + 1]);
+            }
+            REQUIRE(to_time_bits(-0.0) == to_time_bits(0.0));
+        }
+    }
+    GIVEN("Spikes too many to be sorted by comparison, with repeated times and ids") {
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int> tick(-200, 2000);
+        std::uniform_int_distribution<uint64_t> node(1, 300);
+        std::vector<double> times(20000);
+        std::vector<uint64_t> node_ids(times.size());
+        for (size_t i = 0; i < times.size(); ++i) {
+            times[i] = tick(generator) * 0.025;
+            node_ids[i] = node(generator) << (i % 2 == 0 ? 0 : 40);
+        }
+        WHEN("We sort them by time") {
+            const auto expected = reference_sort(times, node_ids, false);
+            sort_spikes(times, node_ids, "by_time");
+            THEN("They are ordered by time then by id") {
+                REQUIRE(times == expected.first);
+                REQUIRE(node_ids == expected.second);
+            }
+        }
+        WHEN("We sort them by id") {
+            const auto expected = reference_sort(times, node_ids, true);
+            sort_spikes(times, node_ids, "by_id");
+            THEN("They are ordered by id then by time") {
+                REQUIRE(times == expected.first);
+                REQUIRE(node_ids == expected.second);
+            }
+        }
+        WHEN("We sort them in no order") {
+            const auto unsorted = std::make_pair(times, node_ids);
+            sort_spikes(times, node_ids, "none");
+            THEN("They are left as they are") {
+                REQUIRE(times == unsorted.first);
+                REQUIRE(node_ids == unsorted.second);
+            }
+        }
+    }
+    GIVEN("Bursty spike trains on 8 ranks, most of them at the start of the simulation") {
+        const size_t num_ranks = 8;
+        std::mt19937 generator(11);
+        std::uniform_int_distribution<int> burst_tick(0, 4);
+        std::uniform_int_distribution<int> tick(0, 40000);
+        std::uniform_int_distribution<uint64_t> node(1, 1000);
+        std::vector<std::vector<SpikeKey>> rank_keys(num_ranks);
+        uint64_t total_spikes = 0;
+        for (size_t rank = 0; rank < num_ranks; ++rank) {
+            // The ranks have different numbers of spikes
+            const size_t num_spikes = 1000 * (rank + 1);
+            for (size_t i = 0; i < num_spikes; ++i) {
+                const int spike_tick = i % 10 < 8 ? burst_tick(generator) : tick(generator);
+                rank_keys[rank].push_back(to_spike_key(spike_tick * 0.025, node(generator), false));
+            }
+            total_spikes += num_spikes;
+        }
+        WHEN("We split them with splitters sampled on every rank") {
+            std::vector<SpikeKey> samples;
+            for (auto& keys : rank_keys) {
+                sort_spike_keys(keys);
+                const auto rank_samples =
+                    sample_spike_keys(keys, get_sample_stride(total_spikes, num_ranks));
+                samples.insert(samples.end(), rank_samples.begin(), rank_samples.end());
+            }
+            const auto splitters = select_splitters(samples, num_ranks);
+            std::vector<std::vector<SpikeKey>> parts(num_ranks);
+            for (const auto& keys : rank_keys) {
+                const auto counts = count_parts(keys, splitters, num_ranks);
+                auto begin = keys.begin();
+                for (size_t part = 0; part < num_ranks; ++part) {
+                    parts[part].insert(parts[part].end(), begin, begin + counts[part]);
+                    begin += counts[part];
+                }
+            }
+            THEN("Every rank gets less than twice its share") {
+                for (const auto& part : parts) {
+                    REQUIRE(part.size() < 2 * total_spikes / num_ranks);
+                }
+            }
+            THEN("The parts sorted one after the other are all the spikes sorted") {
+                std::vector<SpikeKey> all_keys;
+                std::vector<SpikeKey> parts_keys;
+                for (size_t rank = 0; rank < num_ranks; ++rank) {
+                    all_keys.insert(all_keys.end(), rank_keys[rank].begin(), rank_keys[rank].end());
+                    sort_spike_keys(parts[rank]);
+                    parts_keys.insert(parts_keys.end(), parts[rank].begin(), parts[rank].end());
+                }
+                std::sort(all_keys.begin(), all_keys.end());
+                REQUIRE(parts_keys.size() == all_keys.size());
+                REQUIRE(std::equal(parts_keys.begin(),
+                                   parts_keys.end(),
+                                   all_keys.begin(),
+                                   [](const SpikeKey& lhs, const SpikeKey& rhs) {
+                                       return lhs.high == rhs.high && lhs.low == rhs.low;
+                                   }));
+            }
+        }
+    }
+    GIVEN("Fewer samples than parts") {
+        std::vector<SpikeKey> keys{{1, 0}, {2, 0}, {3, 0}};
+        std::vector<SpikeKey> samples{{2, 0}};
+        const auto splitters = select_splitters(samples, 4);
+        THEN("The keys go to the first parts") {
+            REQUIRE(count_parts(keys, splitters, 4) == std::vector<size_t>{1, 0, 0, 2});
+            REQUIRE(count_parts(keys, {}, 4) == std::vector<size_t>{3, 0, 0, 0});
+        }
+    }
+    GIVEN("A few spikes") {
+        std::vector<double> times{0.3, 0.1, 0.2, 1.3, 0.7};
+        std::vector<uint64_t> node_ids{3, 5, 2, 3, 2};
+        WHEN("We sort them by id") {
+            sort_spikes(times, node_ids, "by_id");
+            THEN("They are sorted by comparison") {
+                REQUIRE(times == std::vector<double>{0.2, 0.7, 0.3, 1.3, 0.1});
+                REQUIRE(node_ids == std::vector<uint64_t>{2, 2, 3, 3, 5});
+            }
+        }
+    }
+}
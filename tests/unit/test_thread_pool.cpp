@@ -0,0 +1,68 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <utils/thread_pool.h>
+#include <vector>
+
+using namespace bbp::sonata;
+
+SCENARIO("Test ThreadPool class", "[ThreadPool]") {
+    GIVEN("A pool of 4 threads") {
+        ThreadPool pool(4);
+        THEN("Every thread runs each task once") {
+            REQUIRE(pool.size() == 4);
+            std::vector<int> runs(pool.size(), 0);
+            for (int task = 0; task < 100; ++task) {
+                pool.run([&runs](size_t thread) { ++runs[thread]; });
+            }
+            REQUIRE(runs == std::vector<int>(4, 100));
+        }
+        THEN("The parts of a partition cover the whole range once") {
+            std::vector<std::atomic<int>> writes(1000);
+            std::vector<size_t> begins(pool.size());
+            pool.run([&](size_t thread) {
+                const auto part = partition(writes.size(), thread, pool.size(), 16);
+                begins[thread] = part.first;
+                for (size_t i = part.first; i < part.second; ++i) {
+                    ++writes[i];
+                }
+            });
+            REQUIRE(begins == std::vector<size_t>{0, 256, 512, 768});
+            bool all_once = true;
+            for (const auto& count : writes) {
+                all_once &= count == 1;
+            }
+            REQUIRE(all_once);
+        }
+        THEN("Tasks of concurrent callers run one after the other") {
+            std::vector<int> runs(pool.size(), 0);
+            std::vector<std::thread> callers;
+            for (int caller = 0; caller < 2; ++caller) {
+                callers.emplace_back([&] {
+                    for (int task = 0; task < 100; ++task) {
+                        pool.run([&runs](size_t thread) { ++runs[thread]; });
+                    }
+                });
+            }
+            for (auto& caller : callers) {
+                caller.join();
+            }
+            REQUIRE(runs == std::vector<int>(4, 200));
+        }
+    }
+    GIVEN("A pool of a single thread") {
+        ThreadPool pool(1);
+        THEN("Tasks run on the caller") {
+            size_t calls = 0;
+            pool.run([&calls](size_t thread) { calls += thread + 1; });
+            REQUIRE(calls == 1);
+        }
+    }
+    GIVEN("A range smaller than the number of threads") {
+        THEN("The last threads get empty parts") {
+            REQUIRE(partition(3, 0, 4) == std::make_pair<size_t, size_t>(0, 1));
+            REQUIRE(partition(3, 3, 4) == std::make_pair<size_t, size_t>(3, 3));
+            REQUIRE(partition(3, 1, 4, 16) == std::make_pair<size_t, size_t>(3, 3));
+        }
+    }
+}
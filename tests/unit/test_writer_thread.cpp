@@ -0,0 +1,49 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <thread>
+#include <utils/writer_thread.h>
+#include <vector>
+
+using namespace bbp::sonata;
+
+SCENARIO("Test WriterThread class", "[WriterThread]") {
+    GIVEN("A writer thread") {
+        std::vector<int> order;
+        std::thread::id caller = std::this_thread::get_id();
+        bool on_caller = false;
+        {
+            WriterThread writer;
+            for (int task = 0; task < 100; ++task) {
+                writer.submit([&, task] {
+                    order.push_back(task);
+                    on_caller |= std::this_thread::get_id() == caller;
+                });
+            }
+        }
+        THEN("The tasks are run in the background in the order they were submitted") {
+            std::vector<int> compare(100);
+            for (int task = 0; task < 100; ++task) {
+                compare[task] = task;
+            }
+            REQUIRE(order == compare);
+            REQUIRE_FALSE(on_caller);
+        }
+    }
+    GIVEN("A writer thread with slow tasks queued") {
+        WriterThread writer;
+        std::atomic<int> done{0};
+        for (int task = 0; task < 10; ++task) {
+            writer.submit([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++done;
+            });
+        }
+        THEN("Waiting returns once every task has run") {
+            writer.wait();
+            REQUIRE(done == 10);
+            writer.wait();
+            REQUIRE(done == 10);
+        }
+    }
+}